@@ -21,6 +21,20 @@ if(NOT TARGET SYCL::SYCL)
     )
 endif()
 
+# The module sets SYCL_CTS_PCH_SUPPORTED if the host compile of each test can
+# use a precompiled header, sycl_cts_use_pch is set if the tests use one
+set(sycl_cts_use_pch OFF)
+if(SYCL_CTS_ENABLE_PCH)
+  if(${CMAKE_VERSION} VERSION_LESS 3.16)
+    message(WARNING "SYCL_CTS_ENABLE_PCH requires CMake 3.16 or later")
+  elseif(NOT SYCL_CTS_PCH_SUPPORTED)
+    message(WARNING
+        "SYCL_CTS_ENABLE_PCH is not supported by ${SYCL_IMPLEMENTATION}")
+  else()
+    set(sycl_cts_use_pch ON)
+  endif()
+endif()
+
 if(NOT COMMAND add_sycl_executable_implementation)
     message(FATAL_ERROR
         "The add_sycl_executable_implementation() function implementation could not be found! "
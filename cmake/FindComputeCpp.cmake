@@ -50,6 +50,10 @@ endif()
 add_library(SYCL::SYCL INTERFACE IMPORTED GLOBAL)
 set_target_properties(SYCL::SYCL PROPERTIES INTERFACE_LINK_LIBRARIES ComputeCpp::Runtime)
 
+# the host compiler must see the integration header generated by compute++
+# before any other code, so a precompiled header can't come first
+set(SYCL_CTS_PCH_SUPPORTED OFF)
+
 set(COMPUTECPP_USER_FLAGS "" CACHE STRING "User flags for compute++")
 separate_arguments(COMPUTECPP_USER_FLAGS)
 mark_as_advanced(COMPUTECPP_USER_FLAGS)
@@ -25,6 +25,10 @@ add_library(SYCL::SYCL INTERFACE IMPORTED GLOBAL)
 set_target_properties(SYCL::SYCL PROPERTIES
     INTERFACE_LINK_LIBRARIES INTEL_SYCL::Runtime)
 
+# -fsycl runs the host and device compilers from one invocation, and the
+# device compiler can't load a host precompiled header
+set(SYCL_CTS_PCH_SUPPORTED OFF)
+
 # add_sycl_executable_implementation function
 # Builds a SYCL program, compiling multiple SYCL test case source files into a
 # test executable, invoking a single-source/device compiler
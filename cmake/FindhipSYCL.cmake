@@ -9,6 +9,14 @@ set(CMAKE_C_COMPILER    ${SYCLCC_EXECUTABLE})
 set(CMAKE_CXX_COMPILER  ${SYCLCC_EXECUTABLE})
 set(CMAKE_CXX_STANDARD 14)
 
+# Only the CPU backend, selected with HIPSYCL_PLATFORM, compiles each source
+# in a single host clang invocation which can use a precompiled header. The
+# CUDA and ROCm backends also compile it for the device.
+set(SYCL_CTS_PCH_SUPPORTED OFF)
+if("$ENV{HIPSYCL_PLATFORM}" MATCHES "^(cpu|host|hipcpu)$")
+  set(SYCL_CTS_PCH_SUPPORTED ON)
+endif()
+
 add_library(SYCL::SYCL INTERFACE IMPORTED GLOBAL)
 # add_sycl_executable_implementation function
 # Builds a SYCL program, compiling multiple SYCL test case source files into a
@@ -13,6 +13,11 @@ import time
 import argparse
 import tempfile
 import os
+import sys
+
+sys.path.insert( 0, os.path.join( os.path.dirname(
+    os.path.abspath( __file__ ) ), "tools" ) )
+import decode_log
 
 __author__ = "Codeplay"
 
@@ -26,6 +31,12 @@ g_list_tests    = False
 g_junit_path    = None
 g_platform      = "intel"
 g_device        = "opencl_cpu"
+g_binary_log    = False
+g_repeat        = None
+g_baseline_path = None
+g_save_baseline = None
+g_threshold     = 0.1
+g_min_slowdown  = 0.005
 
 g_types = \
     [
@@ -40,6 +51,17 @@ g_types = \
         "test_end"       ,
         "list_test_name" ,
         "list_test_count",
+        "timing_wall"    ,
+        "timing_user"    ,
+        "timing_system"  ,
+        "timing_setup"   ,
+        "timing_run"     ,
+        "timing_cleanup" ,
+        "memory_rss"     ,
+        "memory_peak"    ,
+        "memory_allocations",
+        "memory_allocated",
+        "memory_frees"   ,
     ]
 
 g_results = \
@@ -78,24 +100,293 @@ def xml_escape( msg ):
     return msg
 
 # ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# lookup a timing value in seconds for a given test ID
 #
+def get_test_time( id, type ):
+
+    l_time = find_packet_data( id, type )
+    if len( l_time ) == 0:
+        return 0.0
+
+    try:
+        return float( l_time[0] )
+    except ValueError:
+        return 0.0
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# lookup a memory value in bytes for a given test ID, None if not reported
 #
-def write_junit_test_case( id ):
+def get_test_memory( id, type ):
 
-    l_name = find_packet_data( id, 'name' )[0]
-    l_result = get_test_result( id )
+    l_bytes = find_packet_data( id, type )
+    if len( l_bytes ) == 0:
+        return None
 
-    l_xml = "  <testcase name='" + l_name + "' time='0'"
+    try:
+        return int( l_bytes[0] )
+    except ValueError:
+        return None
 
-    # test pass
-    if l_result == 'pass':
-        return l_xml + "/>\n"
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# print the tests using the most of a type of memory
+#
+def print_memory_summary( title, type, scale, unit ):
+
+    l_tests = []
+    for id in g_packets:
+        if get_test_result( id ) is None:
+            continue
+        l_value = get_test_memory( id, type )
+        if l_value is None:
+            continue
+        l_tests.append( ( l_value, find_packet_data( id, 'name' )[0] ) )
+
+    l_tests.sort( reverse=True )
+    if len( l_tests ) > 0 and l_tests[0][0] > 0:
+        print(' ' + title + ':')
+        for ( l_value, l_name ) in l_tests[ :10 ]:
+            print('    + ' + '%.1f' % ( l_value / scale ) + unit + ' ' + l_name)
+
+    return
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# collect the 'repeat:' notes written by --repeat, one dict per test
+#
+def get_repeat_stats( ):
+
+    l_stats = []
+    for id in g_packets:
+        for x in find_packet_data( id, 'note' ):
+            if not x.startswith( 'repeat: name=' ):
+                continue
+            l_fields = dict( y.split( '=', 1 )
+                             for y in x[ len( 'repeat: ' ): ].split() )
+            l_stats.append( l_fields )
+
+    return l_stats
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# print the duration spread of repeated tests and those which are flaky
+#
+def print_repeat_summary( ):
+
+    l_stats = get_repeat_stats( )
+    if len( l_stats ) == 0:
+        return
+
+    print(' repeated tests (min / median / p95 / max seconds):')
+    l_flaky = []
+    for x in l_stats:
+        l_runs = int( x[ 'runs' ] )
+        l_passed = int( x[ 'passed' ] )
+        print('    + %s/%s passed, %.3f / %.3f / %.3f / %.3f %s' %
+              ( l_passed, l_runs, float( x[ 'min' ] ), float( x[ 'median' ] ),
+                float( x[ 'p95' ] ), float( x[ 'max' ] ), x[ 'name' ] ))
+        if 0 < l_passed < l_runs:
+            l_flaky.append( x[ 'name' ] )
+
+    if len( l_flaky ) > 0:
+        print(' flaky tests:')
+        for x in l_flaky:
+            print('    + ' + x)
+
+    return
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# total the 'profile:' notes written by --profile-kernels for each kernel
+# of each test
+#
+def get_profile_stats( ):
+
+    l_stats = {}
+    for id in g_packets:
+        for x in find_packet_data( id, 'note' ):
+            if not x.startswith( 'profile: count=' ):
+                continue
+            # the kernel name is last and may contain spaces
+            l_fields = dict( y.split( '=', 1 )
+                             for y in x[ len( 'profile: ' ): ].split( None, 3 ) )
+            # kernel names are only unique within a test
+            l_key = find_packet_data( id, 'name' )[0] + ' ' + l_fields[ 'kernel' ]
+            l_total = l_stats.setdefault( l_key, [ 0, 0.0, 0.0 ] )
+            l_total[0] += int( l_fields[ 'count' ] )
+            l_total[1] += float( l_fields[ 'queued' ] )
+            l_total[2] += float( l_fields[ 'executing' ] )
+
+    return l_stats
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# print the kernels with the most device time and their queueing latency
+#
+def print_profile_summary( ):
+
+    l_stats = get_profile_stats( )
+    if len( l_stats ) == 0:
+        return
+
+    l_kernels = sorted( l_stats.items(), key=lambda x: x[1][2], reverse=True )
+    print(' kernel profiles (runs, mean queued / mean executing us):')
+    for ( l_name, ( l_count, l_queued, l_executing ) ) in l_kernels[ :20 ]:
+        print('    + %d, %.1f / %.1f %s' %
+              ( l_count, 1e6 * l_queued / l_count,
+                1e6 * l_executing / l_count, l_name ))
+
+    return
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# return the median of a list of numbers
+#
+def median( in_values ):
+
+    l_sorted = sorted( in_values )
+    l_mid = len( l_sorted ) // 2
+    if len( l_sorted ) % 2:
+        return l_sorted[ l_mid ]
+    return 0.5 * ( l_sorted[ l_mid - 1 ] + l_sorted[ l_mid ] )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# collect the wall time of every run of each passing test, by test name
+# a run with --repeat gives several samples of each test
+#
+def get_test_durations( ):
+
+    l_durations = {}
+    for id in g_packets:
+        if not get_test_result( id ) in [ 'pass', 'skip' ]:
+            continue
+        l_time = get_test_time( id, 'timing_wall' )
+        if l_time <= 0.0:
+            continue
+        l_name = find_packet_data( id, 'name' )[0]
+        l_durations.setdefault( l_name, [] ).append( l_time )
+
+    return l_durations
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# write the median and noise of each test duration to a baseline file
+# the noise is the median absolute deviation of the samples, scaled to
+# estimate a standard deviation. a 'threshold' added by hand to a test
+# entry overrides the relative slowdown allowed for that test
+#
+def save_baseline( in_path ):
+
+    l_tests = {}
+    l_old = {}
+    if os.path.exists( in_path ):
+        with open( in_path, "r" ) as l_file:
+            l_old = json.load( l_file ).get( 'tests', {} )
+
+    for ( l_name, l_samples ) in get_test_durations( ).items():
+        l_median = median( l_samples )
+        l_mad = median( [ abs( x - l_median ) for x in l_samples ] )
+        l_tests[ l_name ] = { 'median'  : l_median,
+                              'noise'   : 1.4826 * l_mad,
+                              'samples' : len( l_samples ) }
+        # keep thresholds set by hand
+        if 'threshold' in l_old.get( l_name, {} ):
+            l_tests[ l_name ][ 'threshold' ] = l_old[ l_name ][ 'threshold' ]
+
+    with open( in_path, "w" ) as l_file:
+        json.dump( { 'version': 1, 'tests': l_tests }, l_file,
+                   indent=2, sort_keys=True )
+
+    print('wrote a baseline of ' + str( len( l_tests ) ) + ' tests to: \'' +
+          in_path + '\'')
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# compare the durations of this run against a baseline file
+# a test regressed if its median slowed down by more than its threshold,
+# by more than three times the noise of either run and by more than the
+# minimum slowdown, so that short and noisy tests do not trip the gate.
+# returns the number of regressed tests
+#
+def compare_baseline( in_path ):
+
+    with open( in_path, "r" ) as l_file:
+        l_baseline = json.load( l_file ).get( 'tests', {} )
+
+    l_regressions = []
+    for ( l_name, l_samples ) in get_test_durations( ).items():
+        if not l_name in l_baseline:
+            continue
+        l_base = l_baseline[ l_name ]
+        l_median = median( l_samples )
+        l_mad = median( [ abs( x - l_median ) for x in l_samples ] )
+        l_noise = max( l_base.get( 'noise', 0.0 ), 1.4826 * l_mad )
+        l_threshold = l_base.get( 'threshold', g_threshold )
+
+        l_slowdown = l_median - l_base[ 'median' ]
+        if l_slowdown > l_threshold * l_base[ 'median' ] and \
+           l_slowdown > 3.0 * l_noise and \
+           l_slowdown > g_min_slowdown:
+            l_regressions.append( ( l_median / l_base[ 'median' ],
+                                    l_base[ 'median' ], l_median, l_name ) )
+
+    if len( l_regressions ) == 0:
+        print(' no performance regressions against: \'' + in_path + '\'')
+        return 0
+
+    # rank the regressions by how much slower the test became
+    l_regressions.sort( reverse=True )
+    print(' performance regressions (baseline -> now seconds):')
+    for ( l_ratio, l_before, l_after, l_name ) in l_regressions:
+        print('    + %.2fx %.3f -> %.3f %s' %
+              ( l_ratio, l_before, l_after, l_name ))
+
+    return len( l_regressions )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# gather the ids of every run of each test, as given by --repeat
+# returns the test names in the order they first ran and the ids by name
+#
+def get_test_runs( ):
+
+    l_names = []
+    l_runs = {}
+    for id in g_packets:
+
+        # skip packets which do not belong to a test, such as the
+        # summary note
+        if get_test_result( id ) is None:
+            continue
+
+        l_name = find_packet_data( id, 'name' )[0]
+        if not l_name in l_runs:
+            l_names.append( l_name )
+        l_runs.setdefault( l_name, [] ).append( id )
+
+    return ( l_names, l_runs )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# return the id of the run which gives the result of a repeated test, the
+# first which did not pass or skip
+#
+def get_deciding_run( in_ids ):
+
+    for id in in_ids:
+        if not get_test_result( id ) in [ 'pass', 'skip' ]:
+            return id
+    return in_ids[0]
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# write one testcase for every run of a test, as given by --repeat
+# the first run which did not pass or skip gives the result, and the spread
+# of the runs goes in the system-out
+#
+def write_junit_test_case( in_ids, in_stats ):
+
+    l_id = get_deciding_run( in_ids )
+    l_name = find_packet_data( l_id, 'name' )[0]
+    l_result = get_test_result( l_id )
+    l_time = median( [ get_test_time( id, 'timing_wall' ) for id in in_ids ] )
+
+    l_xml = "  <testcase name='" + l_name + "' time='" + str( l_time ) + "'"
+    l_body = ""
 
     # test fail or skip
     if l_result == 'fail' or l_result == 'skip':
-        l_xml += ">\n"
 
-        l_note_list = find_packet_data( id, 'note' )
+        l_note_list = find_packet_data( l_id, 'note' )
         l_stacktrace = ""
         for x in l_note_list:
             l_stacktrace += '. ' + x + '\n'
@@ -103,27 +394,35 @@ def write_junit_test_case( id ):
         l_stacktrace = xml_escape( l_stacktrace )
         if l_result == 'fail':
 
-            l_file = find_packet_data( id, 'file' )
+            l_file = find_packet_data( l_id, 'file' )
             if len( l_file ) > 0:
                 l_stacktrace += "@file: " + l_file[0] + "\n"
-            l_line = find_packet_data( id, 'line' )
+            l_line = find_packet_data( l_id, 'line' )
             if len( l_line ) > 0:
                 l_stacktrace += "@line: " + l_line[0] + "\n"
 
-            l_xml += "    <failure message='error'>\n" + l_stacktrace \
-                  +  "    </failure>\n"
+            l_body += "    <failure message='error'>\n" + l_stacktrace \
+                   +  "    </failure>\n"
 
         if l_result == 'skip':
-            l_xml += "    <skipped>\n" + l_stacktrace \
-                  +  "    </skipped>\n"
-
-        return l_xml + "  </testcase>\n"
+            l_body += "    <skipped>\n" + l_stacktrace \
+                   +  "    </skipped>\n"
 
     # fatal or unknown result
-    return l_xml + ">\n" \
-                 + "    <failure message='fatal'>\nresult was " + l_result + "\n" \
-                 + "    </failure>\n" \
-                 + "  </testcase>\n"
+    elif l_result != 'pass':
+        l_body += "    <failure message='fatal'>\nresult was " + l_result + "\n" \
+               +  "    </failure>\n"
+
+    if not in_stats is None:
+        l_body += "    <system-out>%s/%s runs passed, min / median / p95 / max " \
+                  "seconds %.3f / %.3f / %.3f / %.3f</system-out>\n" % \
+                  ( in_stats[ 'passed' ], in_stats[ 'runs' ],
+                    float( in_stats[ 'min' ] ), float( in_stats[ 'median' ] ),
+                    float( in_stats[ 'p95' ] ), float( in_stats[ 'max' ] ) )
+
+    if l_body == "":
+        return l_xml + "/>\n"
+    return l_xml + ">\n" + l_body + "  </testcase>\n"
 
 # ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
 # produce a junit xml file
@@ -141,10 +440,12 @@ def write_junit_summary( ):
               +  " name='SYCL_CTS'" \
               +  ">\n"
 
-        # itterate over all the tests
-        for id in g_packets:
+        ( l_names, l_runs ) = get_test_runs( )
+        l_stats = dict( ( x[ 'name' ], x ) for x in get_repeat_stats( ) )
 
-            l_xml += write_junit_test_case( id )
+        for l_name in l_names:
+            l_xml += write_junit_test_case( l_runs[ l_name ],
+                                            l_stats.get( l_name ) )
 
         l_xml += "</testsuite>\n"
 
@@ -215,26 +516,38 @@ def print_summary( ):
     l_fails   = 0
     l_skipped = 0
     l_failing_tests = []
+    l_timed_tests = []
 
     try:
-        # iterate over all the test ids
-        for id in g_packets:
+        # count each test once however often --repeat ran it, the runs of a
+        # test give it a single result as in the junit output
+        ( l_names, l_runs ) = get_test_runs( )
+        for l_name in l_names:
 
-            # get the test result for this id
-            l_result = get_test_result( id )
+            l_ids = l_runs[ l_name ]
+            l_result = get_test_result( get_deciding_run( l_ids ) )
+            l_total += 1
 
             if l_result == 'pass':
                 l_passes += 1
 
             if l_result == 'fail':
                 l_fails += 1
-                l_failing_tests.append( find_packet_data( id, 'name' )[0] )
+                # the share of the runs which passed
+                if len( l_ids ) > 1:
+                    l_passed = len( [ id for id in l_ids
+                                      if get_test_result( id ) == 'pass' ] )
+                    l_failing_tests.append( '%s (%d/%d runs passed)' %
+                                            ( l_name, l_passed, len( l_ids ) ) )
+                else:
+                    l_failing_tests.append( l_name )
 
             if l_result == 'skip':
                 l_skipped += 1
 
-            if not (l_result is None):
-                l_total += 1
+            l_timed_tests.append(
+                ( median( [ get_test_time( id, 'timing_wall' )
+                            for id in l_ids ] ), l_name ) )
 
         print(" " + str( l_total ) + ' tests ran in total')
 
@@ -250,6 +563,27 @@ def print_summary( ):
             l_percent = (100 * l_passes) / l_total
         print('  = ' + str( l_percent ) + '% pass rate')
 
+        # list the tests which took the longest
+        l_timed_tests.sort( reverse=True )
+        if len( l_timed_tests ) > 0 and l_timed_tests[0][0] > 0.0:
+            print(' slowest tests:')
+            for ( l_time, l_name ) in l_timed_tests[ :10 ]:
+                print('    + ' + '%.3fs ' % l_time + l_name)
+
+        # list the tests which used the most memory
+        print_memory_summary( 'largest rss growth', 'memory_rss',
+                              1024.0 * 1024.0, 'MiB' )
+        print_memory_summary( 'highest peak rss', 'memory_peak',
+                              1024.0 * 1024.0, 'MiB' )
+        print_memory_summary( 'most bytes allocated', 'memory_allocated',
+                              1024.0 * 1024.0, 'MiB' )
+
+        # list the spread of repeated tests and those which are flaky
+        print_repeat_summary( )
+
+        # list the device time and queueing latency of profiled kernels
+        print_profile_summary( )
+
     except Exception as e:
         print('Exception thrown: ' + e.message)
         pass
@@ -389,6 +723,40 @@ def get_temp_filename( ):
     os.close( l_fd )
     return l_name
 
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# read a binary log while the cts test binary is writing it
+#
+def read_binary_log( in_path, in_exe ):
+
+    with open( in_path, "rb" ) as l_log:
+
+        l_buffer = b""
+
+        while True:
+
+            # read whatever has been written so far
+            l_chunk = l_log.read( 65536 )
+            l_buffer += l_chunk
+
+            # dispatch all complete records
+            ( l_records, l_used ) = decode_log.decode_buffer( l_buffer )
+            l_buffer = l_buffer[ l_used : ]
+            for x in l_records:
+                process_json( decode_log.record_to_json( x ) )
+
+            # check if we are at the eof
+            if not l_chunk:
+                in_exe.poll()
+                if not in_exe.returncode is None:
+                    # pick up anything written before the exit
+                    if not l_log.read( 1 ):
+                        break
+                    l_log.seek( -1, os.SEEK_CUR )
+                else:
+                    time.sleep( 0.01 )
+
+    return
+
 # ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
 # launch cts test binary
 #
@@ -402,7 +770,10 @@ def launch_cts_binary( list ):
         error_exit( "path to cts binary unknown" )
 
     # construct argument
-    l_args = " --json"
+    if g_binary_log:
+        l_args = " --binary"
+    else:
+        l_args = " --json"
     if g_csv_path:
         l_args = l_args + " --csv " + g_csv_path
 
@@ -412,6 +783,9 @@ def launch_cts_binary( list ):
     if g_device:
         l_args += " --device " + g_device
 
+    if g_repeat:
+        l_args += " --repeat " + str( g_repeat )
+
     # add list flag if listing
     if list:
         l_args += " --list"
@@ -430,9 +804,16 @@ def launch_cts_binary( list ):
         l_exe = subprocess.Popen( l_command, stdout=scrap_io, stderr=scrap_io, shell=True )
 
     # read the intermediate file
+    if g_binary_log:
+        read_binary_log( intermediate_file, l_exe )
+        l_exe.wait()
+        scrap_io.close()
+        return True
+
     with open( intermediate_file, "r" ) as l_stdOutLogR:
 
         l_buffer = ""
+        l_exited = False
 
         # iterate over all lines
         while True:
@@ -452,11 +833,13 @@ def launch_cts_binary( list ):
 
             # check if we are at the eof
             if l_line == '':
+                # done reading once the eof is reached after the exit, as the
+                # binary may have written more before it exited
+                if l_exited:
+                    break
                 # check for program exit
                 l_exe.poll()
-                if not l_exe.returncode is None:
-                    # done reading
-                    break
+                l_exited = not l_exe.returncode is None
 
     # close the file handle
     if l_stdOutLogR:
@@ -496,6 +879,12 @@ def parse_args( ):
     global g_list_tests
     global g_platform
     global g_device
+    global g_binary_log
+    global g_repeat
+    global g_baseline_path
+    global g_save_baseline
+    global g_threshold
+    global g_min_slowdown
 
     devices = ['host', 'opencl_cpu', 'opencl_gpu', 'opencl_accelerator']
     platforms = ['host', 'amd', 'arm', 'intel', 'nvidia']
@@ -509,6 +898,14 @@ def parse_args( ):
     parser.add_argument( "-j", "--junit", help="specify output path for a junit xml file" )
     parser.add_argument( "-p", "--platform", choices=platforms, help="The platform to run on " )
     parser.add_argument( "-d", "--device", choices=devices, help="The device to run on " )
+    parser.add_argument( "--binary", help="use the compact binary log format", action="store_true" )
+    parser.add_argument( "--repeat", type=int, help="run the tests this many times and report flaky tests" )
+    parser.add_argument( "--baseline", help="fail if tests ran significantly slower than in this baseline file" )
+    parser.add_argument( "--save-baseline", help="write the test durations of this run to a baseline file" )
+    parser.add_argument( "--threshold", type=float, default=g_threshold,
+                         help="relative slowdown allowed against the baseline, unless a test sets its own" )
+    parser.add_argument( "--min-slowdown", type=float, default=g_min_slowdown,
+                         help="slowdown in seconds below which a test never counts as regressed" )
 
     args = parser.parse_args()
 
@@ -533,6 +930,17 @@ def parse_args( ):
     if 'device' in args:
         g_device = args.device
 
+    if 'binary' in args:
+        g_binary_log = args.binary
+
+    if 'repeat' in args:
+        g_repeat = args.repeat
+
+    g_baseline_path = args.baseline
+    g_save_baseline = args.save_baseline
+    g_threshold = args.threshold
+    g_min_slowdown = args.min_slowdown
+
     return True
 
 # ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
@@ -562,6 +970,17 @@ def main( ):
         # print a junit summary
         write_junit_summary()
 
+    # compare before saving so a baseline can be updated in the same run
+    l_regressions = 0
+    if g_baseline_path:
+        l_regressions = compare_baseline( g_baseline_path )
+
+    if g_save_baseline:
+        save_baseline( g_save_baseline )
+
+    if l_regressions > 0:
+        sys.exit( 1 )
+
     return
 
 # ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
@@ -186,6 +186,6 @@ class TEST_NAME : public sycl_cts::util::test_base {
   }
 };
 
-util::test_proxy<TEST_NAME> proxy;
+util::test_proxy<TEST_NAME> proxy(TOSTRING(TEST_NAME));
 
 } /* namespace TEST_NAME */
@@ -132,6 +132,6 @@ class TEST_NAME : public util::test_base {
 };
 
 // construction of this proxy will register the above test
-util::test_proxy<TEST_NAME> proxy;
+util::test_proxy<TEST_NAME> proxy(TOSTRING(TEST_NAME));
 
 }  // namespace buffer_storage__
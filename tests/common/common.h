@@ -232,6 +232,7 @@ void check_type_min_size_sign_log(sycl_cts::util::logger& log, size_t minSize,
  */
 template <typename kernelT>
 cl::sycl::event get_queue_event(cl::sycl::queue& queue) {
+  sycl_cts::util::trace_scope scope("submit", "sycl");
   return queue.submit([&](cl::sycl::handler& handler) {
     handler.single_task<kernelT>([=]() {});
   });
@@ -340,5 +340,19 @@ def write_source_file(test_str, func_calls, test_name, input_file, output_file,
     source = replace_string_in_source_string(source, test_str, '$TEST_FUNCS')
     source = replace_string_in_source_string(source, func_calls, '$FUNC_CALLS')
 
+    write_if_changed(output_file, source)
+
+
+def write_if_changed(output_file, source):
+    """Writes source to output_file unless the file already holds it, so
+    regenerating a test only changes its timestamp when the test changes.
+    The build records that the generator ran in a separate stamp file."""
+    try:
+        with open(output_file, 'r') as output:
+            if output.read() == source:
+                return
+    except IOError:
+        pass
+
     with open(output_file, 'w+') as output:
         output.write(source)
@@ -14,6 +14,8 @@
 
 #include "../common/cts_async_handler.h"
 #include "../common/cts_selector.h"
+#include "../../util/profiler.h"
+#include "../../util/trace.h"
 
 /** @brief dummy kernel functor for checks that don't require a kernel
  */
@@ -26,54 +28,196 @@ struct dummy_functor {
 namespace sycl_cts {
 namespace util {
 
+/**
+  @brief Returns the properties of the queues created by the CTS, which
+  enable profiling when the harness is run with --profile-kernels
+*/
+inline cl::sycl::property_list cts_queue_properties() {
+  if (get<selector>().profiling()) {
+    return cl::sycl::property_list{
+        cl::sycl::property::queue::enable_profiling()};
+  }
+  return cl::sycl::property_list{};
+}
+
+/**
+  @brief SYCL queue returned by get_cts_object, which records the device
+  timestamps of the command groups submitted to it when the harness is run
+  with --profile-kernels, so that they are reported with the test. Kernels
+  are named by the innermost kernel_name_scope, or else by the type of the
+  command group
+*/
+class cts_queue : public cl::sycl::queue {
+ public:
+  explicit cts_queue(const cl::sycl::queue &queue) : cl::sycl::queue(queue) {}
+
+  template <typename T>
+  cl::sycl::event submit(T cgf) {
+    return profile(cl::sycl::queue::submit(cgf), typeid(T));
+  }
+
+  template <typename T>
+  cl::sycl::event submit(T cgf, cl::sycl::queue &secondaryQueue) {
+    return profile(cl::sycl::queue::submit(cgf, secondaryQueue), typeid(T));
+  }
+
+ private:
+  static cl::sycl::event profile(const cl::sycl::event &event,
+                                 const std::type_info &type) {
+    if (get<selector>().profiling()) {
+      const std::string name = kernel_profiler::kernel_name(type);
+      // read once the test has finished, as reading waits for the kernel
+      kernel_profiler::defer([event, name]() {
+        using cl::sycl::info::event_profiling;
+        try {
+          kernel_profiler::record(
+              name, event.get_profiling_info<event_profiling::command_submit>(),
+              event.get_profiling_info<event_profiling::command_start>(),
+              event.get_profiling_info<event_profiling::command_end>());
+        } catch (const cl::sycl::exception &) {
+          // the kernel failed, so it has no timestamps to report
+        }
+      });
+    }
+    return event;
+  }
+};
+
+/**
+  @brief Default SYCL objects shared by every test of the process when the
+  harness is run with --shared-objects, so that the device is selected and
+  the context created only once and built kernels can be reused. Tests
+  running concurrently with --jobs wait on their queue, so each thread gets
+  a queue of its own on the shared context
+*/
+class shared_cts_objects {
+ public:
+  /**
+    @brief Returns the shared objects, creating them on first use
+  */
+  static shared_cts_objects &get() {
+    static shared_cts_objects objects;
+    return objects;
+  }
+
+  cl::sycl::device device() const { return m_device; }
+  cl::sycl::platform platform() const { return m_device.get_platform(); }
+  cl::sycl::context context() const { return m_context; }
+  cl::sycl::queue queue() const {
+    thread_local cl::sycl::queue threadQueue(
+        m_context, cts_selector(), cts_async_handler(), cts_queue_properties());
+    return threadQueue;
+  }
+
+ private:
+  shared_cts_objects()
+      : m_device(select_device()), m_context(m_device, cts_async_handler()) {}
+
+  static cl::sycl::device select_device() {
+    trace_scope scope("select device", "sycl");
+    return cl::sycl::device(cts_selector());
+  }
+
+  cl::sycl::device m_device;
+  cl::sycl::context m_context;
+};
+
 /**
   @brief Object factory that returns SYCL objects using the CTS selector and CTS
   async handler
 */
 struct get_cts_object {
   /**
-    @brief Creates a SYCL device
-    @param selector Device selector to use to create the device. Uses the CTS
-    selector by default.
+    @brief Returns the default SYCL device, which is shared between tests when
+    the harness is run with --shared-objects
     @return Default SYCL device
   */
-  static cl::sycl::device device(
-      const cl::sycl::device_selector &selector = cts_selector()) {
+  static cl::sycl::device device() {
+    if (get<selector>().shared_objects()) {
+      return shared_cts_objects::get().device();
+    }
+    return device(cts_selector());
+  }
+
+  /**
+    @brief Creates a SYCL device
+    @param selector Device selector to use to create the device
+    @return SYCL device, never a shared one
+  */
+  static cl::sycl::device device(const cl::sycl::device_selector &selector) {
+    trace_scope scope("select device", "sycl");
     return cl::sycl::device(selector);
   }
 
   /**
-    @brief Creates a SYCL platform
-    @param selector Device selector to use to create the platform. Uses the CTS
-    selector by default.
+    @brief Returns the default SYCL platform, which is shared between tests
+    when the harness is run with --shared-objects
     @return Default SYCL platform
   */
+  static cl::sycl::platform platform() {
+    if (get<selector>().shared_objects()) {
+      return shared_cts_objects::get().platform();
+    }
+    return platform(cts_selector());
+  }
+
+  /**
+    @brief Creates a SYCL platform
+    @param selector Device selector to use to create the platform
+    @return SYCL platform, never a shared one
+  */
   static cl::sycl::platform platform(
-      const cl::sycl::device_selector &selector = cts_selector()) {
+      const cl::sycl::device_selector &selector) {
+    trace_scope scope("select platform", "sycl");
     return cl::sycl::platform(selector);
   }
 
   /**
-    @brief Creates a SYCL queue using the CTS async handler
-    @param selector Device selector to use to create the queue. Uses the CTS
-    selector by default.
+    @brief Returns the default SYCL queue using the CTS async handler, which is
+    shared between tests when the harness is run with --shared-objects
     @return Default SYCL queue
   */
-  static cl::sycl::queue queue(
-      const cl::sycl::device_selector &selector = cts_selector()) {
+  static cts_queue queue() {
+    if (get<selector>().shared_objects()) {
+      return cts_queue(shared_cts_objects::get().queue());
+    }
+    return queue(cts_selector());
+  }
+
+  /**
+    @brief Creates a SYCL queue using the CTS async handler
+    @param selector Device selector to use to create the queue. Pass
+    cts_selector() for a new queue on the default device.
+    @return SYCL queue, never a shared one
+  */
+  static cts_queue queue(const cl::sycl::device_selector &selector) {
     static cts_async_handler asyncHandler;
-    return cl::sycl::queue(selector, asyncHandler);
+    trace_scope scope("create queue", "sycl");
+    return cts_queue(
+        cl::sycl::queue(selector, asyncHandler, cts_queue_properties()));
   }
 
   /**
-    @brief Creates a SYCL context using the CTS async handler
-    @param selector Device selector to use to create the context. Uses the CTS
-    selector by default.
+    @brief Returns the default SYCL context using the CTS async handler, which
+    is shared between tests when the harness is run with --shared-objects
     @return Default SYCL context
   */
-  static cl::sycl::context context(
-      const cl::sycl::device_selector &selector = cts_selector()) {
+  static cl::sycl::context context() {
+    if (get<selector>().shared_objects()) {
+      return shared_cts_objects::get().context();
+    }
+    return context(cts_selector());
+  }
+
+  /**
+    @brief Creates a SYCL context using the CTS async handler
+    @param selector Device selector to use to create the context. Pass
+    cts_selector() for a new context on the default device.
+    @return SYCL context, never a shared one
+  */
+  static cl::sycl::context context(const cl::sycl::device_selector &selector) {
     static cts_async_handler asyncHandler;
+    trace_scope scope("create context", "sycl");
     return cl::sycl::context(selector.select_device(), asyncHandler);
   }
 
@@ -90,6 +234,7 @@ struct get_cts_object {
     */
     template <class kernel_name>
     static cl::sycl::kernel prebuilt(cl::sycl::queue &queue) {
+      trace_scope scope("build program", "sycl");
       cl::sycl::program program(queue.get_context());
       program.build_with_kernel_type<kernel_name>();
       return program.get_kernel<kernel_name>();
@@ -118,10 +263,17 @@ struct get_cts_object {
       cl::sycl::program program(ctx);
 
       auto q = queue(selector);
-      q.submit([](cl::sycl::handler &cgh) {
-        cgh.single_task(dummy_functor<kernel_name>());
-      });
-      q.wait_and_throw();
+      {
+        trace_scope scope("submit", "sycl");
+        q.submit([](cl::sycl::handler &cgh) {
+          cgh.single_task(dummy_functor<kernel_name>());
+        });
+      }
+      {
+        trace_scope scope("wait", "sycl");
+        q.wait_and_throw();
+      }
+      trace_scope scope("compile program", "sycl");
       program.compile_with_kernel_type<dummy_functor<kernel_name>>(
           compileOptions);
 
@@ -145,10 +297,17 @@ struct get_cts_object {
       cl::sycl::program program(ctx);
 
       auto q = queue(selector);
-      q.submit([](cl::sycl::handler &cgh) {
-        cgh.single_task(dummy_functor<kernel_name>());
-      });
-      q.wait_and_throw();
+      {
+        trace_scope scope("submit", "sycl");
+        q.submit([](cl::sycl::handler &cgh) {
+          cgh.single_task(dummy_functor<kernel_name>());
+        });
+      }
+      {
+        trace_scope scope("wait", "sycl");
+        q.wait_and_throw();
+      }
+      trace_scope scope("build program", "sycl");
       program.build_with_kernel_type<dummy_functor<kernel_name>>(buildOptions);
 
       return program;
@@ -41,16 +41,17 @@ int main(int argc, const char **args) {
     return -1;
   }
 
-  // Dump device info
-  testManager.dump_device_info();
-
   // if the test harness will execute
+  bool passed = true;
   if (testManager.will_execute()) {
     // run all of the specified tests
-    if (!testManager.run()) {
-      return -1;
-    }
+    passed = testManager.run();
   }
 
-  return 0;
+  // Dump device info
+  // this happens after the run so that test worker processes are never
+  // forked from a process which has already initialised the SYCL runtime
+  testManager.dump_device_info();
+
+  return passed ? 0 : -1;
 }
@@ -160,6 +160,6 @@ class TEST_NAME : public util::test_base {
   }
 };
 
-util::test_proxy<TEST_NAME> proxy;
+util::test_proxy<TEST_NAME> proxy(TOSTRING(TEST_NAME));
 
 }  // TEST_NAMESPACE
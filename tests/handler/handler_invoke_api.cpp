@@ -677,6 +677,6 @@ class TEST_NAME : public sycl_cts::util::test_base {
 };
 
 // register this test with the test_collection
-util::test_proxy<TEST_NAME> proxy;
+util::test_proxy<TEST_NAME> proxy(TOSTRING(TEST_NAME));
 
 } /* namespace handler_invoke_api__ */
@@ -8,7 +8,10 @@
 ################################################################################
 
 import os
+import sys
 import argparse
+sys.path.append(os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', 'common'))
+from common_python_vec import write_if_changed
 from modules import sycl_types
 from modules import sycl_functions
 from modules import test_generator
@@ -50,11 +53,10 @@ def write_cases_to_file(generated_test_cases, inputFile, outputFile, extension=N
         extension = "#ifdef __SYCL_DEVICE_ONLY__\n#ifdef $s\n#pragma OPENCL EXTENSION %s : enable\n#endif\n#endif" % extension
     newSource = newSource.replace("$pragma_ext", extension)
     
-    # Write the source to the output file
-    with open(outputFile, 'w+') as output:
-        output.write(newSource)
+    # Write the source to the output file if it changed
+    write_if_changed(outputFile, newSource)
 
-def create_tests(test_id, run, types, signatures, kind, template, file_name):
+def create_tests(test_id, run, types, signatures, kind, template, file_name, seed, shard, shards):
     expanded_signatures =  test_generator.expand_signatures(run, types, signatures)
     
     # Extensions should be placed on separate files.
@@ -71,13 +73,13 @@ def create_tests(test_id, run, types, signatures, kind, template, file_name):
         base_signatures.append(sig)
 
     if base_signatures and kind == 'base':
-        generated_base_test_cases = test_generator.generate_test_cases(test_id, types, base_signatures)
+        generated_base_test_cases = test_generator.generate_test_cases(test_id, types, base_signatures, seed, shard, shards)
         write_cases_to_file(generated_base_test_cases, template, file_name)
     elif half_signatures and kind == 'half':
-        generated_half_test_cases = test_generator.generate_test_cases(test_id + 300000, types, half_signatures)
+        generated_half_test_cases = test_generator.generate_test_cases(test_id + 300000, types, half_signatures, seed, shard, shards)
         write_cases_to_file(generated_half_test_cases, template, file_name, "cl_khr_fp16")
     elif double_signatures and kind == 'double':
-        generated_double_test_cases = test_generator.generate_test_cases(test_id + 600000, types, double_signatures)
+        generated_double_test_cases = test_generator.generate_test_cases(test_id + 600000, types, double_signatures, seed, shard, shards)
         write_cases_to_file(generated_double_test_cases, template, file_name, "cl_khr_fp64")
     else:
         print("No %s overloads to generate for the test category" % kind)
@@ -94,7 +96,7 @@ def main():
     argparser.add_argument(
         '-test',
         required=True,
-        choices=['integer', 'common', 'geometric', 'relational', 'float', 'native', 'half'],
+        choices=['integer', 'common', 'geometric', 'relational', 'float', 'native', 'half', 'exhaustive'],
         help='')
     argparser.add_argument(
         '-variante',
@@ -107,8 +109,26 @@ def main():
         required=True,
         metavar='<out file>',
         help='CTS test output')
+    argparser.add_argument(
+        '-seed',
+        type=int,
+        default=0,
+        help='Seed for the randomly chosen argument values')
+    argparser.add_argument(
+        '-shards',
+        type=int,
+        default=1,
+        help='Number of files the test cases are split between')
+    argparser.add_argument(
+        '-shard',
+        type=int,
+        default=0,
+        help='Index of the file to generate when the test cases are split')
     args = argparser.parse_args()
 
+    if args.shards < 1 or not 0 <= args.shard < args.shards:
+        argparser.error('-shard must be in the range [0, -shards)')
+
     run = runner()
 
     created_types = sycl_types.create_types()
@@ -117,31 +137,34 @@ def main():
 
     if args.test == 'integer':
         integer_signatures = sycl_functions.create_integer_signatures()
-        create_tests(0, run, expanded_types, integer_signatures, args.variante, args.template, args.output)
+        create_tests(0, run, expanded_types, integer_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
 
     if args.test == 'common':
         common_signatures = sycl_functions.create_common_signatures()
-        create_tests(1000000, run, expanded_types, common_signatures, args.variante, args.template, args.output)
+        create_tests(1000000, run, expanded_types, common_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
 
     if args.test == 'geometric':
         geomteric_signatures = sycl_functions.create_geometric_signatures()
-        create_tests(2000000, run, expanded_types, geomteric_signatures, args.variante, args.template, args.output)
+        create_tests(2000000, run, expanded_types, geomteric_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
 
     if args.test == 'relational':
         relational_signatures = sycl_functions.create_relational_signatures()
-        create_tests(3000000, run, expanded_types, relational_signatures, args.variante, args.template, args.output)
+        create_tests(3000000, run, expanded_types, relational_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
 
     if args.test == 'float':
         float_signatures = sycl_functions.create_float_signatures()
-        create_tests(4000000, run, expanded_types, float_signatures, args.variante, args.template, args.output)
+        create_tests(4000000, run, expanded_types, float_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
 
     if args.test == 'native':
         native_signatures = sycl_functions.create_native_signatures()
-        create_tests(5000000,run, expanded_types, native_signatures, args.variante, args.template, args.output)
+        create_tests(5000000,run, expanded_types, native_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
 
     if args.test == 'half':
         half_signatures = sycl_functions.create_half_signatures()
-        create_tests(6000000, run, expanded_types, half_signatures, args.variante, args.template, args.output)
+        create_tests(6000000, run, expanded_types, half_signatures, args.variante, args.template, args.output, args.seed, args.shard, args.shards)
+
+    if args.test == 'exhaustive':
+        write_cases_to_file(test_generator.generate_exhaustive_tests(), args.template, args.output)
 
 if __name__ == "__main__":
     main()
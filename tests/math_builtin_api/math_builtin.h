@@ -9,40 +9,154 @@
 #ifndef CL_SYCL_CTS_MATH_BUILTIN_API_MATH_BUILTIN_H
 #define CL_SYCL_CTS_MATH_BUILTIN_API_MATH_BUILTIN_H
 
+#include <cmath>
+#include <memory>
+
+#include "../../oclmath/Utility.h"
+#include "../../oclmath/reference_math.h"
+#include "../../util/math_vector.h"
+
 template <int T>
 class kernel;
 
-inline cl::sycl::queue makeQueueOnce() {
-  static cl::sycl::queue q = sycl_cts::util::get_cts_object::queue();
+inline sycl_cts::util::cts_queue makeQueueOnce() {
+  static sycl_cts::util::cts_queue q = sycl_cts::util::get_cts_object::queue();
   return q;
 }
 
-template <int T, typename returnT, typename funT>
-void test_function(funT fun) {
-  cl::sycl::range<1> ndRng(1);
-  returnT *kernelResult = new returnT[1];
+/** the scalar type and number of elements of a builtin result or argument
+ */
+template <typename T>
+struct element_traits {
+  using scalar_t = T;
+  static const int count = 1;
+  static T get(const T &value, int) { return value; }
+};
+
+template <typename T, int N>
+struct element_traits<cl::sycl::vec<T, N>> {
+  using scalar_t = T;
+  static const int count = N;
+  static T get(const cl::sycl::vec<T, N> &value, int index) {
+    return getElement(value, index);
+  }
+};
+
+/** return one element of a builtin argument, a scalar gives its value for
+ *  every element
+ */
+template <typename T>
+typename element_traits<T>::scalar_t element(const T &value, int index) {
+  return element_traits<T>::get(value, index);
+}
+
+/** return the error in ulps of a result, given a more precise reference
+ */
+inline float ulp_error(float test, double reference) {
+  return Ulp_Error(test, reference);
+}
+
+inline float ulp_error(double test, long double reference) {
+  return Ulp_Error_Double(test, reference);
+}
+
+/** calls fun with each of the inputs in one kernel, and reads the results
+ *  back in one transfer
+ *  @param name, the signature of the builtin the kernel is profiled under
+ */
+template <int T, typename inputT, size_t N, typename funT, typename returnT>
+void run_function(const char *name, const inputT (&inputs)[N], funT fun,
+                  returnT *results) {
+  cl::sycl::range<1> ndRng(N);
   auto testQueue = makeQueueOnce();
+  // the gap between the submit and the wait is spent copying results back
+  // as the buffers are destroyed
+  sycl_cts::util::trace_scope kernelScope("kernel", "sycl");
+  sycl_cts::util::kernel_name_scope nameScope(name);
   {
-    cl::sycl::buffer<returnT, 1> buffer(kernelResult, ndRng);
+    cl::sycl::buffer<inputT, 1> inputBuffer(inputs, ndRng);
+    cl::sycl::buffer<returnT, 1> buffer(results, ndRng);
+    sycl_cts::util::trace_scope submitScope("submit", "sycl");
     testQueue.submit([&](cl::sycl::handler &h) {
+      auto inputPtr = inputBuffer.template get_access<cl::sycl::access::mode::read>(h);
       auto resultPtr = buffer.template get_access<cl::sycl::access::mode::write>(h);
-        h.single_task<kernel<T>>([=](){
-          resultPtr[0] = fun();
+        h.parallel_for<kernel<T>>(ndRng, [=](cl::sycl::id<1> i){
+          resultPtr[i] = fun(inputPtr[i]);
         });
     });
   }
-  testQueue.wait_and_throw();
-  delete[] kernelResult;
+  {
+    sycl_cts::util::trace_scope waitScope("wait", "sycl");
+    testQueue.wait_and_throw();
+  }
+}
+
+template <int T, typename returnT, typename inputT, size_t N, typename funT>
+void test_function(const char *name, const inputT (&inputs)[N], funT fun) {
+  std::unique_ptr<returnT[]> kernelResult(new returnT[N]);
+  run_function<T>(name, inputs, fun, kernelResult.get());
+}
+
+/** calls fun with each of the inputs like test_function, and checks every
+ *  element of the results against the reference within the given ulps
+ *  @param ref, returns the reference for one element of the result of an input
+ */
+template <int T, typename returnT, typename inputT, size_t N, typename funT,
+          typename refT>
+void check_function(sycl_cts::util::logger &log, const char *name, float ulps,
+                    const inputT (&inputs)[N], funT fun, refT ref) {
+  using traits = element_traits<returnT>;
+  using scalarT = typename traits::scalar_t;
+  using referenceT = decltype(ref(inputs[0], 0));
+  const size_t count = N * traits::count;
+
+  std::unique_ptr<returnT[]> kernelResult(new returnT[N]);
+  run_function<T>(name, inputs, fun, kernelResult.get());
+
+  // flatten the results and references so they can be compared in bulk
+  std::vector<scalarT> result(count);
+  std::vector<referenceT> reference(count);
+  for (size_t i = 0; i < N; i++) {
+    for (int k = 0; k < traits::count; k++) {
+      result[i * traits::count + k] = traits::get(kernelResult[i], k);
+      reference[i * traits::count + k] = ref(inputs[i], k);
+    }
+  }
+
+  // most results are the rounded reference, so find those first in a loop
+  // the compiler can vectorize, and only compute the error of the others
+  std::vector<uint8_t> inexact(count);
+  for (size_t j = 0; j < count; j++) {
+    const scalarT expected = static_cast<scalarT>(reference[j]);
+    const bool bothNan = (result[j] != result[j]) && (expected != expected);
+    inexact[j] = !(result[j] == expected || bothNan);
+  }
+
+  for (size_t j = 0; j < count; j++) {
+    if (!inexact[j]) continue;
+    const float error = ulp_error(result[j], reference[j]);
+    if (!(std::fabs(error) <= ulps)) {
+      FAIL(log, std::string(name) + " of input " +
+                    std::to_string(j / traits::count) + " element " +
+                    std::to_string(j % traits::count) + " is " +
+                    std::to_string(error) + " ulps from the reference, " +
+                    "above the " + std::to_string(ulps) + " allowed");
+      return;
+    }
+  }
 }
 
 template <int T, typename returnT, typename funT, typename argT>
-void test_function_multi_ptr_global(funT fun, argT arg) {
+void test_function_multi_ptr_global(const char *name, funT fun, argT arg) {
   cl::sycl::range<1> ndRng(1);
   returnT *kernelResult = new returnT[1];
   auto testQueue = makeQueueOnce();
+  sycl_cts::util::trace_scope kernelScope("kernel", "sycl");
+  sycl_cts::util::kernel_name_scope nameScope(name);
   {
     cl::sycl::buffer<returnT, 1> buffer(kernelResult, ndRng);
     cl::sycl::buffer<argT, 1> ptrBuffer(&arg, ndRng);
+    sycl_cts::util::trace_scope submitScope("submit", "sycl");
     testQueue.submit([&](cl::sycl::handler &h) {
       auto resultPtr = buffer.template get_access<cl::sycl::access::mode::write>(h);
       cl::sycl::accessor<argT, 1, cl::sycl::access::mode::read_write, cl::sycl::access::target::global_buffer> globalAccessor(ptrBuffer, h);
@@ -51,17 +165,23 @@ void test_function_multi_ptr_global(funT fun, argT arg) {
         });
     });
   }
-  testQueue.wait_and_throw();
+  {
+    sycl_cts::util::trace_scope waitScope("wait", "sycl");
+    testQueue.wait_and_throw();
+  }
   delete[] kernelResult;
 }
 
 template <int T, typename returnT, typename funT, typename argT>
-void test_function_multi_ptr_local(funT fun, argT arg) {
+void test_function_multi_ptr_local(const char *name, funT fun, argT arg) {
   cl::sycl::range<1> ndRng(1);
   returnT *kernelResult = new returnT[1];
   auto testQueue = makeQueueOnce();
+  sycl_cts::util::trace_scope kernelScope("kernel", "sycl");
+  sycl_cts::util::kernel_name_scope nameScope(name);
   {
     cl::sycl::buffer<returnT, 1> buffer(kernelResult, ndRng);
+    sycl_cts::util::trace_scope submitScope("submit", "sycl");
     testQueue.submit([&](cl::sycl::handler &h) {
       auto resultPtr = buffer.template get_access<cl::sycl::access::mode::write>(h);
       cl::sycl::accessor<argT, 1, cl::sycl::access::mode::read_write, cl::sycl::access::target::local> localAccessor(1, h);
@@ -71,7 +191,10 @@ void test_function_multi_ptr_local(funT fun, argT arg) {
         });
     });
   }
-  testQueue.wait_and_throw();
+  {
+    sycl_cts::util::trace_scope waitScope("wait", "sycl");
+    testQueue.wait_and_throw();
+  }
   delete[] kernelResult;
 }
 
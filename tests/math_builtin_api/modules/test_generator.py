@@ -1,22 +1,59 @@
 from . import sycl_functions
 import random
 
+# Number of inputs each overload is called with in its private memory test.
+# All of them are computed by one kernel.
+batch_size = 16
+
+# Maximum error in ulps of the single and double precision builtins that are
+# checked against the oclmath reference, from the OpenCL 1.2 specification.
+reference_ulps = {
+    "acos": (4, 4), "acosh": (4, 4), "acospi": (5, 5),
+    "asin": (4, 4), "asinh": (4, 4), "asinpi": (5, 5),
+    "atan": (5, 5), "atan2": (6, 6), "atanh": (5, 5),
+    "atanpi": (5, 5), "atan2pi": (6, 6), "cbrt": (2, 2),
+    "ceil": (0, 0), "cos": (4, 4), "cosh": (4, 4), "cospi": (4, 4),
+    "exp": (3, 3), "exp2": (3, 3), "exp10": (3, 3), "expm1": (3, 3),
+    "fabs": (0, 0), "fdim": (0, 0), "floor": (0, 0), "fmax": (0, 0),
+    "fmin": (0, 0), "fmod": (0, 0), "hypot": (4, 4), "log": (3, 3),
+    "log2": (3, 3), "log10": (3, 3), "log1p": (2, 2), "logb": (0, 0),
+    "maxmag": (0, 0), "minmag": (0, 0), "pow": (16, 16), "powr": (16, 16),
+    "remainder": (0, 0), "rint": (0, 0), "round": (0, 0), "rsqrt": (2, 2),
+    "sin": (4, 4), "sinh": (4, 4), "sinpi": (4, 4), "sqrt": (3, 0),
+    "tan": (5, 5), "tanh": (5, 5), "tanpi": (6, 6), "trunc": (0, 0) }
+
+# Single precision builtins which the exhaustive tests check for every
+# float input, with the float ulps of reference_ulps.
+exhaustive_builtins = ["sin", "cos", "tan", "exp", "exp2", "exp10", "log",
+                       "log2", "log10", "sqrt", "rsqrt", "cbrt"]
+
 test_case_templates = { "private" : ("\n\n{\n"
-                    "test_function<$TEST_ID, $RETURN_TYPE>(\n"
-                    "[=](){\n"
+                    "$DECL"
+                    "test_function<$TEST_ID, $RETURN_TYPE>(\"$SIGNATURE\", inputs,\n"
+                    "[=](inputT in){\n"
+                    "$FUNCTION_CALL"
+                    "});\n}\n"),
+
+                    "checked" : ("\n\n{\n"
+                    "$DECL"
+                    "check_function<$TEST_ID, $RETURN_TYPE>(log, \"$SIGNATURE\", $ULPS, inputs,\n"
+                    "[=](inputT in){\n"
                     "$FUNCTION_CALL"
+                    "},\n"
+                    "[](const inputT &in, int k){\n"
+                    "$REFERENCE_CALL"
                     "});\n}\n"),
 
                     "local" : ("\n\n{\n"
                     "$DECL"
-                    "test_function_multi_ptr_local<$TEST_ID, $RETURN_TYPE>(\n"
+                    "test_function_multi_ptr_local<$TEST_ID, $RETURN_TYPE>(\"$SIGNATURE\",\n"
                     "[=]($ACCESSOR acc){\n"
                     "$FUNCTION_CALL"
                     "}, $DATA);\n}\n"),
 
                     "global" : ("\n\n{\n"
                     "$DECL"
-                    "test_function_multi_ptr_global<$TEST_ID, $RETURN_TYPE>(\n"
+                    "test_function_multi_ptr_global<$TEST_ID, $RETURN_TYPE>(\"$SIGNATURE\",\n"
                     "[=]($ACCESSOR acc){\n"
                     "$FUNCTION_CALL"
                     "}, $DATA);\n}\n") }
@@ -61,14 +98,36 @@ def generate_multi_ptr(var_name, var_type, var_index, memory):
     if memory == "local":
         decl = "cl::sycl::multi_ptr<" + var_type.name + ", cl::sycl::access::address_space::local_space> " + var_name + "(acc);\n"
     if memory == "private":
-        source_name = "multiPtrSource_" + str(var_index)
-        decl = var_type.name + " " + source_name + "(" + generate_value(var_type.base_type, var_type.dim, var_type.unsigned) + ");\n"
-        decl += "cl::sycl::multi_ptr<" + var_type.name + ", cl::sycl::access::address_space::private_space> " + var_name + "(&" + source_name + ");\n"
+        # Points to the copy of the input passed to the function under test.
+        decl = "cl::sycl::multi_ptr<" + var_type.name + ", cl::sycl::access::address_space::private_space> " + var_name + "(&in." + var_name + ");\n"
     return decl
 
 def generate_variable(var_name, var_type, var_index):
     return var_type.name + " " + var_name + "(" + generate_value(var_type.base_type, var_type.dim, var_type.unsigned) + ");\n"
 
+def generate_value_expression(var_type):
+    value = generate_value(var_type.base_type, var_type.dim, var_type.unsigned)
+    # Casting scalars avoids narrowing in the braced initializer of the inputs.
+    if var_type.var_type == "scalar":
+        return "static_cast<" + var_type.name + ">(" + value + ")"
+    return var_type.name + "(" + value + ")"
+
+# Declares the inputs of the private memory test of an overload, an array
+# of batch_size structures holding one value for each argument.
+def generate_batch_inputs(types, sig):
+    decl = "struct inputT {\n"
+    arg_index = 0
+    for arg in sig.arg_types:
+        decl += extract_type(types[arg]).name + " inputData_" + str(arg_index) + ";\n"
+        arg_index += 1
+    decl += "};\n"
+    decl += "const inputT inputs[] = {\n"
+    for i in range(batch_size):
+        values = [generate_value_expression(extract_type(types[arg])) for arg in sig.arg_types]
+        decl += "{" + ", ".join(values) + "},\n"
+    decl += "};\n"
+    return decl
+
 def extract_type(type_dict):
     # At this point, it is guaranteed that type_dict is a dictionary with one entry.
     for bt in list(type_dict.keys()):
@@ -84,7 +143,6 @@ def generate_arguments(types, sig, memory):
         
         # Create argument name.
         arg_name = "inputData_" + str(arg_index)
-        arg_names.append(arg_name)
         
         # Identify whether aegument is a pointer.
         is_pointer = False
@@ -95,8 +153,13 @@ def generate_arguments(types, sig, memory):
         current_arg = ""
         if is_pointer:
             current_arg = generate_multi_ptr(arg_name, arg_type, arg_index, memory)
+            arg_names.append(arg_name)
+        elif memory == "private":
+            # Private memory tests take the value from their batch of inputs.
+            arg_names.append("in." + arg_name)
         else:
             current_arg = generate_variable(arg_name, arg_type, arg_index)
+            arg_names.append(arg_name)
         
         arg_src += current_arg
         arg_index += 1
@@ -111,12 +174,49 @@ def generate_function_call(types, sig, memory):
     fc = fc[:-1] + ");\n"
     return fc
 
+# Returns the ulps allowed for a signature with an oclmath reference, or
+# None when its results are not checked.
+def get_reference_ulps(types, sig):
+    if sig.namespace != "cl::sycl" or sig.name not in reference_ulps or sig.pntr_indx:
+        return None
+    base_type = extract_type(types[sig.ret_type]).base_type
+    if base_type != "float" and base_type != "double":
+        return None
+    for arg in sig.arg_types:
+        if extract_type(types[arg]).base_type != base_type:
+            return None
+    (float_ulps, double_ulps) = reference_ulps[sig.name]
+    return float_ulps if base_type == "float" else double_ulps
+
+def generate_reference_call(types, sig):
+    # The long double references are used for double precision.
+    suffix = "l" if extract_type(types[sig.ret_type]).base_type == "double" else ""
+    args = ["element(in.inputData_" + str(i) + ", k)" for i in range(len(sig.arg_types))]
+    return "return reference_" + sig.name + suffix + "(" + ", ".join(args) + ");\n"
+
+# The signature a test case names its kernel and failures by, pointer
+# arguments are given with the address space they point to.
+def generate_signature(sig, memory):
+    args = []
+    for i, arg in enumerate(sig.arg_types):
+        args.append(arg + " " + memory + " *" if (i + 1) in sig.pntr_indx else arg)
+    return sig.ret_type + " " + sig.namespace + "::" + sig.name + "(" + ", ".join(args) + ")"
+
 def generate_test_case(test_id, types, sig, memory):
-    testCaseSource = test_case_templates[memory]
+    ulps = get_reference_ulps(types, sig) if memory == "private" else None
+    if ulps is not None:
+        testCaseSource = test_case_templates["checked"]
+        testCaseSource = testCaseSource.replace("$ULPS", str(ulps))
+        testCaseSource = testCaseSource.replace("$REFERENCE_CALL", generate_reference_call(types, sig))
+    else:
+        testCaseSource = test_case_templates[memory]
     testCaseId = str(test_id)
     testCaseSource = testCaseSource.replace("$TEST_ID", testCaseId)
     testCaseSource = testCaseSource.replace("$RETURN_TYPE", sig.ret_type)
-    if memory != "private":
+    testCaseSource = testCaseSource.replace("$SIGNATURE", generate_signature(sig, memory))
+    if memory == "private":
+        testCaseSource = testCaseSource.replace("$DECL", generate_batch_inputs(types, sig))
+    else:
         # We rely on the fact that all SYCL math builtins have at most one arguments as pointer.
         pointerType = sig.arg_types[sig.pntr_indx[0] - 1]
         sourcePtrDataName = "multiPtrSourceData"
@@ -132,17 +232,32 @@ def generate_test_case(test_id, types, sig, memory):
     testCaseSource = testCaseSource.replace("$FUNCTION_CALL", generate_function_call(types, sig, memory))
     return testCaseSource
 
-def generate_test_cases(test_id, types, sig_list):
-    random.seed(0)
+# Generates the registration of an exhaustive test for each builtin of
+# exhaustive_builtins.
+def generate_exhaustive_tests():
+    tests = ""
+    for name in exhaustive_builtins:
+        tests += "EXHAUSTIVE_TEST(" + name + ", " + str(reference_ulps[name][0]) + ")\n"
+    return tests
+
+# Generates the test cases of one shard out of a number of shards, each
+# shard holding a contiguous range of the signatures.
+# Cases are generated for every signature so the values and test ids of a
+# signature do not depend on the number of shards.
+def generate_test_cases(test_id, types, sig_list, seed=0, shard=0, shards=1):
+    # The same seed always generates the same values
+    random.seed(seed)
     test_source = ""
-    for sig in sig_list:
-        test_source += generate_test_case(test_id, types, sig, "private")
+    for index, sig in enumerate(sig_list):
+        case_source = generate_test_case(test_id, types, sig, "private")
         test_id += 1
         if sig.pntr_indx:#If the signature contains a pointer argument.
-            test_source += generate_test_case(test_id, types, sig, "local")
+            case_source += generate_test_case(test_id, types, sig, "local")
             test_id += 1
-            test_source += generate_test_case(test_id, types, sig, "global")
+            case_source += generate_test_case(test_id, types, sig, "global")
             test_id += 1
+        if index * shards // len(sig_list) == shard:
+            test_source += case_source
     return test_source
 
 # Given the current combination of:
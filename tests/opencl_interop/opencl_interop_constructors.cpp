@@ -481,6 +481,6 @@ class TEST_NAME : public sycl_cts::util::test_base_opencl {
 };
 
 // register this test with the test_collection
-util::test_proxy<TEST_NAME> proxy;
+util::test_proxy<TEST_NAME> proxy(TOSTRING(TEST_NAME));
 
 } /* namespace opencl_interop_constructors__ */
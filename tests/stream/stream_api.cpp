@@ -279,6 +279,8 @@ class TEST_NAME : public util::test_base {
 };
 
 // register this test with the test_collection.
-util::test_proxy<TEST_NAME> proxy;
+// cl::sycl::stream writes straight to stdout, so the test must run alone.
+util::test_proxy<TEST_NAME> proxy(TOSTRING(TEST_NAME),
+                                  util::test_base::eserial);
 
 } /* namespace TEST_NAMESPACE */
@@ -14,7 +14,8 @@ from itertools import product
 sys.path.append('../common/')
 from common_python_vec import (Data, ReverseData, replace_string_in_source_string,
                                swap_pairs, generate_value_list,
-                               append_fp_postfix, wrap_with_kernel)
+                               append_fp_postfix, wrap_with_kernel,
+                               write_if_changed)
 
 swizzle_template = Template(
     """        cl::sycl::vec<${type}, ${size}> ${name}DimTestVec = cl::sycl::vec<${type}, ${size}>(${testVecValues});
@@ -287,8 +288,7 @@ def write_source_file(swizzles, input_file, output_file, type_str):
     source = replace_string_in_source_string(source, swizzles[5],
                                              '$16D_SWIZZLES')
 
-    with open(output_file, 'w+') as output:
-        output.write(source)
+    write_if_changed(output_file, source)
 
 
 def get_reverse_type(type_str):
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+################################################################################
+##
+##  SYCL 1.2.1 Conformance Test Suite
+##
+##  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+##
+################################################################################
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+__author__ = "Codeplay"
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# binary record layout, see binary_formatter in util/printer.cpp
+#
+#   uint32  size of the rest of the record in bytes
+#   int32   log id
+#   uint8   packet type
+#   uint8   payload kind, 0 for a string and 1 for an int32
+#   uint64  microseconds since the printer was created
+#   ...     payload
+#
+g_size_format   = "<I"
+g_header_format = "<iBBQ"
+g_size_bytes    = struct.calcsize( g_size_format )
+g_header_bytes  = struct.calcsize( g_header_format )
+
+g_kind_string   = 0
+g_kind_int      = 1
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# exit with an error message
+#
+def error_exit( string ):
+    print(string)
+    exit( 1 )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# decode one record, returning ( id, type, data, micros )
+#
+def decode_record( in_record ):
+
+    ( l_id, l_type, l_kind, l_micros ) = \
+        struct.unpack_from( g_header_format, in_record )
+    l_payload = in_record[ g_header_bytes : ]
+
+    if l_kind == g_kind_int:
+        ( l_data, ) = struct.unpack( "<i", l_payload )
+    else:
+        l_data = l_payload.decode( "utf-8", "replace" )
+
+    return ( l_id, l_type, l_data, l_micros )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# decode all complete records at the start of a buffer
+# returns the decoded records and the number of bytes consumed
+#
+def decode_buffer( in_buffer ):
+
+    l_records = []
+    l_offset = 0
+
+    while len( in_buffer ) - l_offset >= g_size_bytes:
+        ( l_size, ) = struct.unpack_from( g_size_format, in_buffer, l_offset )
+        if l_size < g_header_bytes:
+            error_exit( "malformed binary record at offset " + str( l_offset ) )
+
+        l_end = l_offset + g_size_bytes + l_size
+        if l_end > len( in_buffer ):
+            # the rest of this record has not been written yet
+            break
+
+        l_records.append(
+            decode_record( in_buffer[ l_offset + g_size_bytes : l_end ] ) )
+        l_offset = l_end
+
+    return ( l_records, l_offset )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# convert a record to the packet the JSON formatter would have written
+#
+def record_to_json( in_record ):
+    ( l_id, l_type, l_data, l_micros ) = in_record
+    return { 'id': l_id, 'type': l_type, 'data': str( l_data ) }
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# read every record in a binary log file
+#
+def read_log( in_path ):
+
+    with open( in_path, "rb" ) as l_file:
+        l_buffer = l_file.read()
+
+    ( l_records, l_used ) = decode_buffer( l_buffer )
+    if l_used != len( l_buffer ):
+        print( "warning: ignoring truncated record at the end of the log" )
+
+    return l_records
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# write the records as JSON lines, as produced by --json
+#
+def write_json( in_records, in_out ):
+    for x in in_records:
+        in_out.write( json.dumps( record_to_json( x ),
+                                  separators=( ',', ':' ) ) + "\n" )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# write a junit xml file using the runtests.py reporting
+#
+def write_junit( in_records, in_path ):
+
+    sys.path.insert( 0, os.path.join( os.path.dirname(
+        os.path.abspath( __file__ ) ), os.pardir ) )
+    import runtests
+
+    for x in in_records:
+        runtests.process_json( record_to_json( x ) )
+
+    runtests.g_junit_path = in_path
+    runtests.write_junit_summary( )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+# entry point
+#
+def main( ):
+
+    parser = argparse.ArgumentParser(
+        description="Convert a binary SYCL CTS log, written with --binary, "
+                    "to JSON lines or a junit xml file" )
+
+    parser.add_argument( "log", help="path to the binary log file" )
+    parser.add_argument( "-o", "--output",
+                         help="write JSON lines to this file instead of stdout" )
+    parser.add_argument( "-j", "--junit",
+                         help="specify output path for a junit xml file" )
+
+    args = parser.parse_args()
+
+    l_records = read_log( args.log )
+
+    if args.junit:
+        write_junit( l_records, args.junit )
+        return
+
+    if args.output:
+        with open( args.output, "w" ) as l_out:
+            write_json( l_records, l_out )
+    else:
+        write_json( l_records, sys.stdout )
+
+# ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ---- ----
+#
+#
+if __name__ == '__main__':
+    main( )
@@ -6,9 +6,12 @@
 //
 *******************************************************************************/
 
+#include <cstdlib>
+
 #include "collection.h"
 #include "printer.h"
 #include "csv.h"
+#include "hash.h"
 
 // conformance test suite namespace
 namespace sycl_cts {
@@ -18,75 +21,82 @@ namespace util {
  *  a c function is used to avoid having to pull in an extra
  *  header for the definition of the collection object.
  */
-extern void register_test(test_base *test) {
-  assert(test != nullptr);
-  get<collection>().add_test(test);
+extern void register_test(const char *name, test_factory factory, int flags,
+                          int timeout) {
+  assert(name != nullptr && factory != nullptr);
+  get<collection>().add_test(name, factory, flags, timeout);
+}
+
+/** return true if the test passed, or gave the result the csv file expects
+ */
+bool collection::test_info::gave_expected_result() const {
+  if (m_expected != logger::epending) {
+    return m_result == m_expected;
+  }
+  return (m_result == logger::epass) || (m_result == logger::eskip);
 }
 
 /** constructor
  */
-collection::collection() : m_tests() {}
+collection::collection() : m_tests(), m_sorted(true) {}
 
 /** add a test to the collection
- *  @param test, the test to be added
+ *  @param name, the name of the test
+ *  @param factory, function constructing the test object
+ *  @param flags, test_base::eflags describing how the test is scheduled
+ *  @param timeout, seconds the test may run for, -1 for the default
  */
-void collection::add_test(test_base *testobj) {
-  assert(testobj != nullptr);
+void collection::add_test(const std::string &name, test_factory factory,
+                          int flags, int timeout) {
+  assert(factory != nullptr);
 
   // encapsulate in testinfo structure
   test_info test = {
-      testobj,  // test
-      false,    // skip
-      -1        // timeout
+      name,                               // name
+      factory,                            // factory
+      false,                              // skip
+      timeout,                            // timeout
+      (flags & test_base::eserial) != 0,  // serial
+      false,                              // replay
+      logger::epending,                   // result
+      -1.0,                               // duration
+      false,                              // failed before
+      logger::epending                    // expected
   };
 
   // add this test to the collection
   m_tests.push_back(test);
+  m_sorted = false;
 }
 
-/**
- *
+/** release all registered tests
  */
 void collection::release() {
-  // iterate over all tests in the collection
-  const int32_t numTests = int32_t(m_tests.size());
-
-  for (int32_t i = 0; i < numTests; i++) {
-    // locate a specific test
-    test_info &test = m_tests.at(size_t(i));
-
-    assert(test.m_test != nullptr);
-
-    // free this test
-    delete test.m_test;
-    test.m_test = nullptr;
-  }
-
-  // clear the vector
+  // test objects only live while they run, so only the entries remain
   m_tests.clear();
 }
 
 /** output a list of all the tests contained by this collection
  */
-void collection::list() {
+void collection::list(bool selectedOnly) {
   // iterate over all tests in the collection
   const int32_t numTests = int32_t(m_tests.size());
 
   // output test count
-  get<printer>().write(-1, printer::epacket::list_test_count, numTests);
+  int32_t numListed = 0;
+  for (int32_t i = 0; i < numTests; i++) {
+    if (!selectedOnly || !m_tests[size_t(i)].m_skip) numListed++;
+  }
+  get<printer>().write(-1, printer::epacket::list_test_count, numListed);
 
   // iterate over all of the contained tests
   for (int32_t i = 0; i < numTests; i++) {
     // locate a specific test
     test_info &test = m_tests.at(size_t(i));
-
-    assert(test.m_test != nullptr);
-
-    test_base::info testInfo;
-    test.m_test->get_info(testInfo);
+    if (selectedOnly && test.m_skip) continue;
 
     // output the test name
-    get<printer>().write(-1, printer::epacket::list_test_name, testInfo.m_name);
+    get<printer>().write(-1, printer::epacket::list_test_name, test.m_name);
   }
 }
 
@@ -107,47 +117,171 @@ collection::test_info &collection::get_test(int32_t index) {
   test_info &test = m_tests.at(size_t(index));
 
   // check that test is really valid
-  assert(test.m_test != nullptr);
+  assert(test.m_factory != nullptr);
 
   return test;
 }
 
-/** perform a partial string match.
- *  return true if entire string 'b' can be found at the beginning of
- *  string 'a'.
+/** return true if a pattern contains glob wildcards
  */
-static inline bool partial_strcmp(const std::string &a, const std::string &b) {
-  const char *_a = a.c_str();
-  const char *_b = b.c_str();
+static inline bool is_glob(const std::string &pattern) {
+  return pattern.find_first_of("*?") != std::string::npos;
+}
 
-  // advance both string in lock step
-  for (;; _a++, _b++) {
-    // if 'b' is totally consumed then we pass
-    if (*_b == '\0') return true;
+/** match a name against a glob pattern, where '*' matches any run of
+ *  characters and '?' matches any single character
+ */
+static bool glob_match(const char *name, const char *pattern) {
+  // position to resume from after the last '*'
+  const char *starName = nullptr;
+  const char *starPattern = nullptr;
+
+  while (*name != '\0') {
+    if (*pattern == '*') {
+      starPattern = ++pattern;
+      starName = name;
+    } else if (*pattern == '?' || *pattern == *name) {
+      pattern++;
+      name++;
+    } else if (starPattern != nullptr) {
+      // let the last '*' swallow one more character
+      pattern = starPattern;
+      name = ++starName;
+    } else {
+      return false;
+    }
+  }
 
-    // if they are equal advance
-    if (*_a == *_b) continue;
+  // only trailing '*' may remain
+  while (*pattern == '*') pattern++;
+  return *pattern == '\0';
+}
 
-    // otherwise 'b' does not prefix 'a'
-    return false;
+/** split a comma separated list, trimming spaces around each item
+ */
+static std::vector<std::string> split_list(const std::string &list) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) end = list.size();
+
+    std::string item = list.substr(begin, end - begin);
+    const size_t first = item.find_first_not_of(' ');
+    const size_t last = item.find_last_not_of(' ');
+    if (first != std::string::npos) {
+      items.push_back(item.substr(first, last - first + 1));
+    }
+    begin = end + 1;
   }
+  return items;
 }
 
-/** set the skip status of a test by name
+/** convert the name of a test result, as written in a csv file
  */
-void collection::set_test_skip(const std::string &testName, bool) {
-  //       yet the linear search here is likely not a hot spot
-  for (int32_t i = 0; i < int32_t(m_tests.size()); i++) {
-    test_info &info = m_tests.at(size_t(i));
-    sycl_cts::util::test_base::info testInfo;
-    info.m_test->get_info(testInfo);
-
-    // if 'testName' is prefix of test name
-    if (partial_strcmp(testInfo.m_name, testName)) {
-      // we do not want to skip this test
-      info.m_skip = false;
+static bool parse_result(const std::string &name, logger::result &result) {
+  static const struct {
+    const char *m_name;
+    logger::result m_result;
+  } kResults[] = {{"pass", logger::epass},
+                  {"fail", logger::efail},
+                  {"skip", logger::eskip},
+                  {"fatal", logger::efatal},
+                  {"timeout", logger::etimeout}};
+
+  for (const auto &known : kResults) {
+    if (name == known.m_name) {
+      result = known.m_result;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** return the indices of all tests matching a pattern
+ *  a plain pattern matches every test whose name begins with it, a pattern
+ *  containing '*' or '?' must match the whole name. as the tests are kept
+ *  sorted by name only the range sharing the literal prefix is searched.
+ */
+std::vector<int32_t> collection::find_tests(const std::string &pattern) {
+  if (!m_sorted) prepare();
+
+  const bool glob = is_glob(pattern);
+  const std::string prefix =
+      glob ? pattern.substr(0, pattern.find_first_of("*?")) : pattern;
+
+  // first test which may begin with the prefix
+  auto first = std::lower_bound(
+      m_tests.begin(), m_tests.end(), prefix,
+      [](const test_info &info, const std::string &p) {
+        return info.m_name.compare(0, p.size(), p) < 0;
+      });
+
+  std::vector<int32_t> matches;
+  for (auto it = first; it != m_tests.end(); ++it) {
+    // the tests sharing the prefix are contiguous
+    if (it->m_name.compare(0, prefix.size(), prefix) != 0) break;
+
+    if (!glob || glob_match(it->m_name.c_str(), pattern.c_str())) {
+      matches.push_back(int32_t(it - m_tests.begin()));
+    }
+  }
+  return matches;
+}
+
+/** set the skip status of all tests matching a pattern
+ */
+void collection::set_test_skip(const std::string &testName, bool skip) {
+  for (int32_t i : find_tests(testName)) {
+    m_tests[size_t(i)].m_skip = skip;
+  }
+}
+
+/** set the timeout of all tests matching a pattern
+ */
+void collection::set_test_timeout(const std::string &testName, int timeout) {
+  for (int32_t i : find_tests(testName)) {
+    m_tests[size_t(i)].m_timeout = timeout;
+  }
+}
+
+/** set the expected result of all tests matching a name
+ */
+void collection::set_test_expected(const std::string &testName,
+                                   logger::result result) {
+  for (int32_t i : find_tests(testName)) {
+    m_tests[size_t(i)].m_expected = result;
+  }
+}
+
+/** skip every test unless a pattern selects it
+ *  patterns starting with '!' exclude the matching tests instead. if only
+ *  exclusions are given all other tests are kept.
+ */
+bool collection::filter_tests(const std::vector<std::string> &patterns) {
+  bool hasInclusions = false;
+  for (const auto &pattern : patterns) {
+    // a lone '!' would exclude every test
+    if (pattern == "!") {
+      std::cout << "'!' must be followed by the tests to exclude" << std::endl;
+      return false;
     }
+    hasInclusions |= (pattern[0] != '!');
+  }
+
+  // pre-pass sets all tests to be skipped if anything is selected
+  for (auto &info : m_tests) {
+    info.m_skip = hasInclusions;
+  }
+
+  // enable the selected tests first so exclusions always win
+  for (const auto &pattern : patterns) {
+    if (pattern[0] != '!') set_test_skip(pattern, false);
+  }
+  for (const auto &pattern : patterns) {
+    if (pattern[0] == '!') set_test_skip(pattern.substr(1), true);
   }
+  return true;
 }
 
 /** load a test filter (csv file)
@@ -156,48 +290,107 @@ void collection::set_test_skip(const std::string &testName, bool) {
 bool collection::filter_tests_csv(const std::string &csvPath) {
   // try to load the csv file
   csv csvFile;
+  std::string error;
   if (!csvFile.load_file(csvPath)) {
     // unable to load the CSV file
+    if (csvFile.get_last_error(error)) std::cout << error << std::endl;
     return false;
   }
 
-  // pre-pass sets all tests to be skipped
-  for (int32_t i = 0; i < int32_t(m_tests.size()); i++) {
-    test_info &info = m_tests.at(size_t(i));
-    info.m_skip = true;
-  }
-
   // loop over all rows in the CSV file
+  std::vector<std::string> patterns;
   for (int32_t r = 0; r < csvFile.size(); r++) {
-    // first column is test name
-    std::string csvName;
-    if (!csvFile.get_item(r, 0, csvName)) continue;
+    // first column is a test name pattern
+    const csv::field csvName = csvFile.get_field(r, 0);
 
     // check for empty string
     if (csvName.empty()) continue;
 
-    // enable a test with this name
-    set_test_skip(csvName, false);
+    patterns.push_back(csvName.str());
+    if (csvName.m_data[0] == '!') continue;
+
+    // second column is an optional timeout in seconds
+    const csv::field csvTimeout = csvFile.get_field(r, 1);
+    if (!csvTimeout.empty()) {
+      set_test_timeout(patterns.back(), std::atoi(csvTimeout.str().c_str()));
+    }
+
+    // third column is an optional expected result
+    const csv::field csvExpected = csvFile.get_field(r, 2);
+    if (!csvExpected.empty()) {
+      logger::result expected;
+      if (!parse_result(csvExpected.str(), expected)) {
+        std::cout << "unknown expected result '" << csvExpected.str()
+                  << "' for " << patterns.back() << std::endl;
+        return false;
+      }
+      set_test_expected(patterns.back(), expected);
+    }
   }
 
-  return true;
+  return filter_tests(patterns);
 }
 
-/**
+/** filter tests by a comma separated list of name patterns
  */
 bool collection::filter_tests_name(const std::string &name) {
-  // todo: extend to take a comma separated list of names
+  return filter_tests(split_list(name));
+}
 
-  // pre-pass sets all tests to be skipped
+/** skip all tests not assigned to one shard of the selected tests
+ *  the assignment only depends on the test names, and with balancing on
+ *  the history, so every machine of a sharded run agrees on it.
+ */
+void collection::filter_shard(int32_t index, int32_t count, bool balance) {
+  assert(count > 0 && index >= 0 && index < count);
+  if (!m_sorted) prepare();
+
+  std::vector<int32_t> selected;
   for (int32_t i = 0; i < int32_t(m_tests.size()); i++) {
-    test_info &info = m_tests.at(size_t(i));
-    info.m_skip = true;
+    if (!m_tests[size_t(i)].m_skip) selected.push_back(i);
   }
 
-  // enable a test with this name
-  set_test_skip(name, false);
+  std::vector<int32_t> shardOf(m_tests.size(), -1);
+  if (!balance) {
+    // a stable hash keeps each test on the same shard as tests come and go
+    for (int32_t i : selected) {
+      const std::string &name = m_tests[size_t(i)].m_name;
+      const uint64_t hash = mix64(fnv1a(kFnvOffset, name));
+      shardOf[size_t(i)] = int32_t(hash % uint64_t(count));
+    }
+  } else {
+    // tests without a history are assumed to take the average time
+    double known = 0.0;
+    int32_t numKnown = 0;
+    for (int32_t i : selected) {
+      if (m_tests[size_t(i)].m_duration >= 0.0) {
+        known += m_tests[size_t(i)].m_duration;
+        numKnown++;
+      }
+    }
+    const double fallback = (numKnown > 0) ? known / numKnown : 1.0;
+    auto duration = [&](int32_t i) {
+      const double d = m_tests[size_t(i)].m_duration;
+      return (d >= 0.0) ? d : fallback;
+    };
+
+    // hand the longest remaining test to the least loaded shard
+    std::stable_sort(selected.begin(), selected.end(),
+                     [&](int32_t a, int32_t b) {
+                       return duration(a) > duration(b);
+                     });
+    std::vector<double> load(size_t(count), 0.0);
+    for (int32_t i : selected) {
+      const size_t shard = size_t(
+          std::min_element(load.begin(), load.end()) - load.begin());
+      load[shard] += duration(i);
+      shardOf[size_t(i)] = int32_t(shard);
+    }
+  }
 
-  return true;
+  for (int32_t i : selected) {
+    m_tests[size_t(i)].m_skip = (shardOf[size_t(i)] != index);
+  }
 }
 
 /** this function act as a comparator between two tests
@@ -206,28 +399,18 @@ bool collection::filter_tests_name(const std::string &name) {
  */
 static bool test_order_func(const collection::test_info &a,
                             const collection::test_info &b) {
-  // get test a info
-  assert(a.m_test != nullptr);
-
-  test_base::info aInfo;
-  a.m_test->get_info(aInfo);
-
-  // get test b info
-  assert(b.m_test != nullptr);
-
-  test_base::info bInfo;
-  b.m_test->get_info(bInfo);
-
   // use std::string compare operator
-  return aInfo.m_name < bInfo.m_name;
+  return a.m_name < b.m_name;
 }
 
 /** prepare the list of tests for execution
  *
  */
 void collection::prepare() {
-  // sort the list of tests using our sort function
+  // sort the list of tests using our sort function, which also makes the
+  // list the index searched by find_tests()
   std::sort(m_tests.begin(), m_tests.end(), test_order_func);
+  m_sorted = true;
 }
 
 }  // namespace util
@@ -12,6 +12,8 @@
 #include "stl.h"
 #include "test_base.h"
 #include "singleton.h"
+#include "proxy.h"
+#include "logger.h"
 
 namespace sycl_cts {
 namespace util {
@@ -23,9 +25,28 @@ class collection : public singleton<collection> {
   /** test structure
    */
   struct test_info {
-    test_base *m_test;
+    std::string m_name;
+    // constructs the test object when the test is about to run
+    test_factory m_factory;
     bool m_skip;
+    // seconds the test may run for, -1 for the default
     int m_timeout;
+    bool m_serial;
+    // report the result cached by an earlier run instead of running
+    bool m_replay;
+    // result of the last execution, epending if it has not run
+    logger::result m_result;
+    // seconds the test last took to run, < 0 if it never ran
+    double m_duration;
+    // true if the test failed the last time it ran, according to history
+    bool m_failedBefore;
+    // result the test is expected to give, epending if it should pass
+    logger::result m_expected;
+
+    /** return true if the test passed, or gave the result the csv file
+     *  expects
+     */
+    bool gave_expected_result() const;
   };
 
   /** constructor
@@ -33,9 +54,13 @@ class collection : public singleton<collection> {
   collection();
 
   /** add a test to the collection
-   *  @param test, the test to be added
+   *  @param name, the name of the test
+   *  @param factory, function constructing the test object
+   *  @param flags, test_base::eflags describing how the test is scheduled
+   *  @param timeout, seconds the test may run for, -1 for the default
    */
-  void add_test(test_base *test);
+  void add_test(const std::string &name, test_factory factory,
+                int flags = test_base::enone, int timeout = -1);
 
   /** run all tests in the collection
    */
@@ -46,18 +71,33 @@ class collection : public singleton<collection> {
   void release();
 
   /** list all tests in the collection
+   *  @param selectedOnly, only list the tests which are not skipped
    */
-  void list();
+  void list(bool selectedOnly = false);
 
   /** load a test filter (csv file)
+   *  the first column of each row is a test name prefix or glob, or one
+   *  starting with '!' to exclude the matching tests. an optional second
+   *  column gives the timeout in seconds of the matching tests, and an
+   *  optional third column the result they are expected to give
    *  @param csvPath, the csv file path fir filtering the tests
    */
   bool filter_tests_csv(const std::string &csvPath);
 
   /** filter tests by name
+   *  @param testName, comma separated list of test name prefixes or globs,
+   *                   those starting with '!' exclude the matching tests
    */
   bool filter_tests_name(const std::string &testName);
 
+  /** skip all tests not assigned to one shard of the selected tests
+   *  @param index, the shard to keep, from 0 to count - 1
+   *  @param count, number of shards the selected tests are split into
+   *  @param balance, balance the shards by the durations of the tests in
+   *                  earlier runs rather than by a hash of their names
+   */
+  void filter_shard(int32_t index, int32_t count, bool balance);
+
   /** get the total number of tests in this collection
    */
   int32_t get_test_count() const;
@@ -71,12 +111,32 @@ class collection : public singleton<collection> {
   void prepare();
 
  protected:
-  /** set the skip status of a test by name
+  /** return the indices of all tests matching a name prefix or glob
+   */
+  std::vector<int32_t> find_tests(const std::string &pattern);
+
+  /** skip all tests not selected by a list of patterns
+   *  @return, false if a pattern is an exclusion without a name
+   */
+  bool filter_tests(const std::vector<std::string> &patterns);
+
+  /** set the skip status of all tests matching a name
    */
   void set_test_skip(const std::string &testName, bool skip);
 
-  // the test collection itself
+  /** set the timeout of all tests matching a name
+   */
+  void set_test_timeout(const std::string &testName, int timeout);
+
+  /** set the expected result of all tests matching a name
+   */
+  void set_test_expected(const std::string &testName, logger::result result);
+
+  // the test collection itself, sorted by name once prepared
   std::vector<test_info> m_tests;
+
+  // false if tests were added since the collection was last sorted
+  bool m_sorted;
 };
 
 }  // namespace util
@@ -6,14 +6,38 @@
 //
 *******************************************************************************/
 
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SYCL_CTS_HAS_MMAP 1
+#endif
+
+#include <iterator>
+
 #include "csv.h"
 
 namespace sycl_cts {
 namespace util {
 
+namespace {
+/** return true for the white space trimmed from fields
+ */
+bool is_blank(char ch) { return ch == ' ' || ch == '\t' || ch == '\r'; }
+}  // namespace
+
 /** constructor
  */
-csv::csv() : m_error(), m_items(), m_rowIndex() {}
+csv::csv()
+    : m_error(),
+      m_data(nullptr),
+      m_size(0),
+      m_mapped(false),
+      m_buffer(),
+      m_items(),
+      m_rowIndex(),
+      m_unescaped() {}
 
 /** destructor
  */
@@ -22,73 +46,119 @@ csv::~csv() { release(); }
 /** load a CSV file from disk
  */
 bool csv::load_file(const std::string &path) {
-  // load the raw file
-  std::ifstream stream(path, std::ios::in | std::ios::binary);
-  if (!stream.is_open()) {
+  release();
+
+#if defined(SYCL_CTS_HAS_MMAP)
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
     m_error = "unable to open file";
     return false;
   }
 
-  // start parsing a new row
-  m_rowIndex.push_back(0);
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void *map = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE,
+                     fd, 0);
+    if (map != MAP_FAILED) {
+      m_data = static_cast<const char *>(map);
+      m_size = size_t(info.st_size);
+      m_mapped = true;
+    }
+  }
+  close(fd);
+#endif
+
+  // read the file if it could not be mapped
+  if (!m_mapped) {
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    if (!stream.is_open()) {
+      m_error = "unable to open file";
+      return false;
+    }
+    m_buffer.assign(std::istreambuf_iterator<char>(stream),
+                    std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+  }
 
-  // make a buffer to pull together each entry
-  int32_t index = 0;
-  char buffer[64];
+  return parse(m_data, m_data + m_size);
+}
 
-  // parse all characters in the input file
-  char ch = '\0';
-  for (;;) {
-    // read a character from the stream
-    stream.read(&ch, sizeof(ch));
-    if (!stream.good()) break;
+/** split the loaded text into rows and fields
+ */
+bool csv::parse(const char *begin, const char *end) {
+  const char *p = begin;
+  while (p < end) {
+    while (p < end && is_blank(*p)) p++;
+    if (p == end) break;
+
+    // skip blank lines and comments
+    if (*p == '\n') {
+      p++;
+      continue;
+    }
+    if (*p == '#') {
+      while (p < end && *p != '\n') p++;
+      continue;
+    }
+
+    // start parsing a new row
+    m_rowIndex.push_back(int(m_items.size()));
+
+    for (;;) {
+      while (p < end && is_blank(*p)) p++;
+
+      field item = {p, 0};
+      if (p < end && *p == '"') {
+        // quoted fields may hold commas and "" for a quote
+        const char *start = ++p;
+        bool escaped = false;
+        while (p < end && !(*p == '"' && (p + 1 == end || p[1] != '"'))) {
+          escaped |= (*p == '"');
+          p += (*p == '"') ? 2 : 1;
+        }
+        if (p == end) {
+          m_error = "unterminated quoted value";
+          return false;
+        }
+        item.m_data = start;
+        item.m_size = size_t(p - start);
+        p++;
+
+        if (escaped) {
+          std::string value;
+          for (const char *c = start; c < start + item.m_size; c++) {
+            value += *c;
+            if (*c == '"') c++;
+          }
+          m_unescaped.push_back(value);
+          item.m_data = m_unescaped.back().data();
+          item.m_size = m_unescaped.back().size();
+        }
+
+        while (p < end && is_blank(*p)) p++;
+        if (p < end && *p != ',' && *p != '\n') {
+          m_error = "unexpected characters after a quoted value";
+          return false;
+        }
+      } else {
+        while (p < end && *p != ',' && *p != '\n') p++;
+        const char *last = p;
+        while (last > item.m_data && is_blank(last[-1])) last--;
+        item.m_size = size_t(last - item.m_data);
+      }
+      m_items.push_back(item);
 
-    switch (ch) {
-      // skip over these characters
-      case (' '):
-      case ('\r'):
+      // marks next entry in a column
+      if (p < end && *p == ',') {
+        p++;
         continue;
+      }
 
-      // new line start of new row
-      case ('\n'): {
-        // null terminate the buffer string
-        buffer[index] = '\0';
-        // add string to items list
-        m_items.push_back(std::string(buffer));
-        index = 0;
-
-        // index of next item marks start of new row
-        int32_t items = int32_t(m_items.size());
-        m_rowIndex.push_back(items);
-      } break;
-
-      // marks next entry in a column
-      case (','): {
-        // null terminate the buffer string
-        buffer[index] = '\0';
-        // add string to items list
-        m_items.push_back(std::string(buffer));
-        index = 0;
-      } break;
-
-      // add new character to the buffer
-      default:
-        // check for buffer overflow
-        if (index >= int32_t(sizeof(buffer) - 1u)) {
-          m_error = "value exceeds buffer length";
-          return false;
-        } else
-          buffer[index++] = ch;
-
-    };  // switch
-  };    // while
-
-  // push any remaining item
-  if (index > 0) {
-    // null terminate the buffer string
-    buffer[index] = '\0';
-    // add string to items list
-    m_items.push_back(std::string(buffer));
+      // new line or end of file ends the row
+      if (p < end) p++;
+      break;
+    }
   }
 
   return true;
@@ -97,8 +167,37 @@ bool csv::load_file(const std::string &path) {
 /**
  */
 void csv::release() {
+#if defined(SYCL_CTS_HAS_MMAP)
+  if (m_mapped) {
+    munmap(const_cast<char *>(m_data), m_size);
+  }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear();
   m_items.clear();
   m_rowIndex.clear();
+  m_unescaped.clear();
+}
+
+/** return a csv value without copying it
+ */
+csv::field csv::get_field(int32_t row, int32_t column) const {
+  const field none = {"", 0};
+  const int32_t nRowIndices = int32_t(m_rowIndex.size());
+  const int32_t nItems = int32_t(m_items.size());
+
+  // test if row is valid
+  if (row < 0 || row >= nRowIndices || column < 0) return none;
+
+  // find the location of the requested element
+  const int32_t index = m_rowIndex[size_t(row)] + column;
+
+  // find the index of the end of this row
+  const int32_t limit =
+      ((row + 1) < nRowIndices) ? m_rowIndex[size_t(row + 1)] : nItems;
+  return (index < limit) ? m_items[size_t(index)] : none;
 }
 
 /**
@@ -129,7 +228,7 @@ bool csv::get_item(int32_t row, int32_t column, std::string &out) {
 
   // output the item asked for
   assert(index < nItems && index >= 0);
-  out = m_items.at(size_t(index));
+  out = m_items.at(size_t(index)).str();
 
   // success
   return true;
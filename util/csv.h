@@ -9,18 +9,32 @@
 #ifndef __SYCLCTS_UTIL_CSV_H
 #define __SYCLCTS_UTIL_CSV_H
 
+#include <deque>
+
 #include "stl.h"
 
 namespace sycl_cts {
 namespace util {
 
-/** category, testname, timeout, regression y/n
- */
-
 /** comma separated values file parser
+ *
+ *  the file is mapped into memory and each field refers to its text in
+ *  the mapping, so loading does not copy the file. fields may be quoted to
+ *  hold commas, with "" for a quote, and lines starting with '#' are
+ *  comments. blank lines are ignored.
  */
 class csv {
  public:
+  /** a span of text within the file
+   */
+  struct field {
+    const char *m_data;
+    size_t m_size;
+
+    bool empty() const { return m_size == 0; }
+    std::string str() const { return std::string(m_data, m_size); }
+  };
+
   /** constructor destructor
    */
   csv();
@@ -46,18 +60,39 @@ class csv {
    */
   bool get_item(int32_t row, int32_t column, std::string &out);
 
+  /** return a csv value without copying it
+   *  @return, an empty field if the row has no such column
+   */
+  field get_field(int32_t row, int32_t column) const;
+
  protected:
+  /** split the loaded text into rows and fields
+   */
+  bool parse(const char *begin, const char *end);
+
   // the last error message set
   std::string m_error;
 
-  // raw items from the csv file
-  std::vector<std::string> m_items;
+  // the mapped file, or m_buffer if it could not be mapped
+  const char *m_data;
+  size_t m_size;
+  bool m_mapped;
+  std::vector<char> m_buffer;
+
+  // fields of all rows in order
+  std::vector<field> m_items;
 
   // indices for the start of a row
   std::vector<int> m_rowIndex;
+
+  // quoted fields holding "" escapes, which can't refer to the file
+  std::deque<std::string> m_unescaped;
+
+  // disable copy constructors
+  csv(const csv &);
 };
 
 }  // namespace util
 }  // namespace sycl_cts
 
-#endif  // __SYCLCTS_UTIL_CSV_H
\ No newline at end of file
+#endif  // __SYCLCTS_UTIL_CSV_H
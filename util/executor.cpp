@@ -6,76 +6,475 @@
 //
 *******************************************************************************/
 
+#include <cmath>
+#include <memory>
+#include <thread>
+
 #include "executor.h"
 #include "singleton.h"
 #include "printer.h"
 #include "collection.h"
 #include "logger.h"
+#include "supervisor.h"
+#include "profiler.h"
+#include "trace.h"
 
 namespace sycl_cts {
 namespace util {
 
-/** execute all tests in the collection
+namespace {
+/** return the name of a test result as shown on the trace timeline
  */
-bool executor::run_all() {
+const char *result_name(logger::result result) {
+  switch (result) {
+    case logger::epass:
+      return "pass";
+    case logger::efail:
+      return "fail";
+    case logger::eskip:
+      return "skip";
+    case logger::efatal:
+      return "fatal";
+    case logger::etimeout:
+      return "timeout";
+    default:
+      return "pending";
+  }
+}
+
+/** construct a test from its factory and fetch the information it reports
+ */
+std::unique_ptr<test_base> construct_test(const collection::test_info &info,
+                                          test_base::info &testInfo) {
+  std::unique_ptr<test_base> test(info.m_factory());
+  test->get_info(testInfo);
+  return test;
+}
+}  // namespace
+
+/** constructor
+ */
+executor::executor()
+    : m_jobCount(1),
+      m_workerCount(0),
+      m_defaultTimeout(-1),
+      m_longestFirst(false),
+      m_failedFirst(false),
+      m_repeatCount(1),
+      m_repeatUntilFail(false) {}
+
+/** set the number of tests which may execute concurrently
+ */
+void executor::set_job_count(int32_t jobs) {
+  m_jobCount = (jobs > 1) ? jobs : 1;
+}
+
+/** set the number of worker processes tests are executed in
+ */
+void executor::set_worker_count(int32_t workers) {
+  m_workerCount = (workers > 0) ? workers : 0;
+}
+
+/** set the timeout of tests which do not specify their own
+ */
+void executor::set_default_timeout(int timeout) { m_defaultTimeout = timeout; }
+
+/** set the order tests are started in
+ */
+void executor::set_schedule(bool longestFirst, bool failedFirst) {
+  m_longestFirst = longestFirst;
+  m_failedFirst = failedFirst;
+}
+
+/** set how many times the selected tests are run
+ */
+void executor::set_repeat(int32_t count, bool untilFail) {
+  m_repeatCount = count;
+  m_repeatUntilFail = untilFail;
+}
+
+/** return the number of seconds a test may run for
+ */
+int executor::get_timeout(const collection::test_info &info) const {
+  return (info.m_timeout > 0) ? info.m_timeout : m_defaultTimeout;
+}
+
+/** construct a single test, execute it and emit its log
+ */
+logger::result executor::run_test(collection::test_info &info) {
+  // the test object only lives for as long as the test runs
+  std::unique_ptr<test_base> test(info.m_factory());
+
+  const time_sample start = sample_time();
+  const logger::result result = run_test(*test);
+  info.m_duration = sample_time().m_wall - start.m_wall;
+  return result;
+}
+
+/** execute a constructed test and emit its log
+ */
+logger::result executor::run_test(test_base &test) {
+  // log for this test execution
+  logger logger;
+
+  // write the test info header
+  test_base::info testInfo;
+  test.get_info(testInfo);
+  logger.preamble(testInfo);
+
+  logger.test_start();
+
+  // kernels left over from an earlier test on this thread
+  kernel_profiler::take();
+
+  // memory used over the whole test
+  reset_peak_memory();
+  const memory_sample memoryStart = sample_memory();
+
+  // time taken by each phase of the test
+  const time_sample start = sample_time();
+  time_sample setupEnd = start;
+  time_sample runEnd = start;
+
+  // we must install an exception handler here so that if a test
+  // fails to catch a thrown exception it wont crash the entire
+  // test suite
+  try {
+    // ask the test to set itself up
+    const bool ready = test.setup(logger);
+    setupEnd = runEnd = sample_time();
+    if (ready) {
+      // ask the test to execute
+      test.run(logger);
+      runEnd = sample_time();
+    }
+    // enforce that each test must give a result
+    assert(logger.get_result() != logger::epending);
+
+    // ask the test to clean up after itself
+    test.cleanup();
+  } catch (...) {
+    logger.fail("Exception thrown and not caught by test case!", 0);
+  }
+
+  const time_sample end = sample_time();
+  // process wide cpu time includes the tests running alongside this one
+  logger.timing(start, setupEnd, runEnd, end,
+                end.m_perThread || m_jobCount == 1);
+  logger.memory(memoryStart, sample_memory());
+
+  // queueing latency and device time of the kernels the test executed,
+  // the kernel name goes last as it may contain spaces
+  for (const auto &stats : kernel_profiler::take()) {
+    logger.note(
+        "profile: count=%d queued=%.9f executing=%.9f kernel=%s",
+        stats.m_count, double(stats.m_queued) * 1e-9,
+        double(stats.m_executing) * 1e-9, stats.m_name.c_str());
+  }
+  logger.test_end();
+
+  // place the test and its phases on the timeline
+  trace &timeline = get<trace>();
+  if (timeline.enabled()) {
+    timeline.complete(testInfo.m_name.c_str(), "test", start.m_wall,
+                      end.m_wall, result_name(logger.get_result()));
+    timeline.complete("setup", "phase", start.m_wall, setupEnd.m_wall);
+    timeline.complete("run", "phase", setupEnd.m_wall, runEnd.m_wall);
+    timeline.complete("cleanup", "phase", runEnd.m_wall, end.m_wall);
+  }
+
+  return logger.get_result();
+}
+
+/** order tests using the history of earlier runs
+ */
+void executor::schedule(std::vector<int32_t> &tests) const {
+  if (!m_longestFirst && !m_failedFirst) {
+    return;
+  }
+
+  collection &c = get<collection>();
+  const bool longestFirst = m_longestFirst;
+  const bool failedFirst = m_failedFirst;
+
+  // the tests arrive sorted by name, which a stable sort keeps for ties
+  std::stable_sort(tests.begin(), tests.end(), [&](int32_t a, int32_t b) {
+    const collection::test_info &x = c.get_test(a);
+    const collection::test_info &y = c.get_test(b);
+
+    if (failedFirst && (x.m_failedBefore != y.m_failedBefore)) {
+      return x.m_failedBefore;
+    }
+
+    if (longestFirst) {
+      // tests without a history may be long, so they start first
+      const bool xKnown = (x.m_duration >= 0.0);
+      const bool yKnown = (y.m_duration >= 0.0);
+      if (xKnown != yKnown) return !xKnown;
+      return x.m_duration > y.m_duration;
+    }
+    return false;
+  });
+}
+
+/** report the result an earlier run recorded for a test without running it
+ */
+logger::result executor::replay(collection::test_info &info) {
+  test_base::info testInfo;
+  std::unique_ptr<test_base> test(construct_test(info, testInfo));
+
+  logger logger;
+  logger.preamble(testInfo);
+  logger.test_start();
+
+  if (info.m_result == logger::eskip) {
+    logger.skip("Replayed a skip from the results cache");
+  } else {
+    logger.note("Replayed a pass from the results cache");
+  }
+
+  logger.test_end();
+  return logger.get_result();
+}
+
+/** execute a single test while the watchdog enforces its timeout
+ */
+logger::result executor::run_watched(collection::test_info &info,
+                                     watchdog &dog) {
+  test_base::info testInfo;
+  std::unique_ptr<test_base> test(construct_test(info, testInfo));
+
+  const int32_t handle = dog.start(testInfo, get_timeout(info));
+  const time_sample start = sample_time();
+  const logger::result result = run_test(*test);
+  info.m_duration = sample_time().m_wall - start.m_wall;
+  dog.stop(handle);
+
+  return result;
+}
+
+/** execute the given tests on a pool of worker threads
+ */
+bool executor::run_concurrent(const std::vector<int32_t> &tests,
+                              std::atomic<int32_t> &numPassed, watchdog &dog) {
+  std::atomic<size_t> nextTest(0);
+  std::atomic<bool> fatal(false);
+
+  // each worker claims the next unstarted test until none remain
+  auto worker = [&]() {
+    for (;;) {
+      const size_t i = nextTest.fetch_add(1);
+      if (i >= tests.size() || fatal) break;
+
+      collection::test_info &info = get<collection>().get_test(tests[i]);
+
+      // keep the packets of this test together in the output
+      get<printer>().begin_capture();
+      const logger::result result = run_watched(info, dog);
+      get<printer>().end_capture();
+      info.m_result = result;
+
+      if ((result == logger::epass) || (result == logger::eskip)) {
+        ++numPassed;
+      }
+
+      // if we received a fatal error then no further tests are started
+      if (result == logger::efatal) {
+        fatal = true;
+      }
+    }
+  };
+
+  const size_t nWorkers = std::min(size_t(m_jobCount), tests.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < nWorkers; i++) {
+    workers.push_back(std::thread(worker));
+  }
+  for (auto &thread : workers) {
+    thread.join();
+  }
+
+  return !fatal;
+}
+
+namespace {
+/** results of one test over all rounds of a repeated run
+ */
+struct repeat_record {
+  int32_t runs;
+  int32_t passes;
+  std::vector<double> durations;
+};
+
+/** return the duration below which a fraction of the sorted durations lie
+ */
+double percentile(const std::vector<double> &sorted, double fraction) {
+  const size_t rank = size_t(std::ceil(fraction * double(sorted.size())));
+  return sorted[(rank > 0) ? rank - 1 : 0];
+}
+/** report the duration statistics and pass ratio of repeated tests
+ *  each test gets one note of space separated key=value pairs starting
+ *  with "repeat:", which runtests.py collects into its summary
+ */
+void report_repeats(const std::vector<repeat_record> &records,
+                    int32_t numRounds) {
+  logger log;
+  log.note("repeat: rounds=%d", numRounds);
+
+  for (int32_t i = 0; i < int32_t(records.size()); i++) {
+    const repeat_record &record = records[size_t(i)];
+    if (record.runs == 0) continue;
+
+    std::vector<double> sorted = record.durations;
+    std::sort(sorted.begin(), sorted.end());
+
+    log.note(
+        "repeat: name=%s runs=%d passed=%d min=%.6f median=%.6f p95=%.6f "
+        "max=%.6f",
+        get<collection>().get_test(i).m_name.c_str(), record.runs,
+        record.passes, sorted.front(), percentile(sorted, 0.5),
+        percentile(sorted, 0.95), sorted.back());
+  }
+}
+
+}  // namespace
+
+/** execute every selected test once
+ */
+bool executor::run_round(bool firstRound, int32_t &numReplayed) {
   // find the number of tests in the collection
   const int32_t nTests = get<collection>().get_test_count();
-  int32_t numPassed = 0;
+  std::atomic<int32_t> numPassed(0);
+
+  // tests which may run alongside others and those which must run alone
+  const bool concurrent = (m_jobCount > 1) || (m_workerCount > 0);
+  std::vector<int32_t> concurrentTests;
+  std::vector<int32_t> serialTests;
 
   // iterate over all tests
   for (int32_t i = 0; i < nTests; i++) {
     // locate a specific test
     collection::test_info &info = get<collection>().get_test(i);
-    test_base *test = info.m_test;
 
     // do not execute any test marked to be skipped
     if (info.m_skip) {
       continue;
     }
 
-    // scope for the logger
-    {
-      // log for this test execution
-      logger logger;
-
-      // write the test info header
-      test_base::info testInfo;
-      test->get_info(testInfo);
-      logger.preamble(testInfo);
-
-      logger.test_start();
-
-      // we must install an exception handler here so that if a test
-      // fails to catch a thrown exception it wont crash the entire
-      // test suite
-      try {
-        // ask the test to set itself up
-        if (test->setup(logger)) {
-          // ask the test to execute
-          test->run(logger);
-        }
-        // enforce that each test must give a result
-        assert(logger.get_result() != logger::epending);
-
-        if ((logger.get_result() == logger::epass) ||
-            (logger.get_result() == logger::eskip)) {
-          ++numPassed;
-        }
-
-        // ask the test to clean up after itself
-        test->cleanup();
-      } catch (...) {
-        logger.fail("Exception thrown and not caught by test case!", 0);
+    // report the cached result of a test which has not changed, once
+    if (info.m_replay) {
+      if (firstRound) {
+        replay(info);
+        numReplayed++;
       }
+      continue;
+    }
+
+    info.m_result = logger::epending;
+    if (concurrent && !info.m_serial) {
+      concurrentTests.push_back(i);
+    } else {
+      serialTests.push_back(i);
+    }
+  }
+
+  // decide the order tests are started in
+  schedule(concurrentTests);
+  schedule(serialTests);
+
+  // enforces the timeouts of tests running in this process, worker
+  // processes are watched by the supervisor instead
+  watchdog dog(numPassed, nTests);
+
+  bool fatal = false;
+  if (m_workerCount > 0) {
+    // crash isolated execution, tests that must run alone get one worker
+    // to themselves once the others have finished
+    fatal = !supervisor(m_workerCount).run(concurrentTests, numPassed) ||
+            !supervisor(1).run(serialTests, numPassed);
+    serialTests.clear();
+  } else {
+    fatal = !run_concurrent(concurrentTests, numPassed, dog);
+  }
+
+  // tests that must run alone execute in order once the pool has drained
+  for (size_t i = 0; i < serialTests.size() && !fatal; i++) {
+    collection::test_info &info = get<collection>().get_test(serialTests[i]);
+    const logger::result result = run_watched(info, dog);
+    info.m_result = result;
+
+    if ((result == logger::epass) || (result == logger::eskip)) {
+      ++numPassed;
+    }
 
-      logger.test_end();
+    // if we received a fatal error then we must exit
+    fatal = (result == logger::efatal);
+  }
+
+  return !fatal;
+}
+
+/** execute all tests in the collection
+ */
+bool executor::run_all() {
+  // find the number of tests in the collection
+  const int32_t nTests = get<collection>().get_test_count();
+  int32_t numReplayed = 0;
 
-      // if we received a fatal error then we must exit
-      if (logger.get_result() == logger::efatal) {
-        break;
+  // results of each test over all rounds
+  std::vector<repeat_record> records(static_cast<size_t>(nTests));
+  int32_t numRounds = 0;
+
+  for (;;) {
+    bool fatal;
+    {
+      trace_scope scope("round", "harness");
+      fatal = !run_round(numRounds == 0, numReplayed);
+    }
+    numRounds++;
+
+    // gather the results of the tests which ran in this round
+    bool failed = false;
+    for (int32_t i = 0; i < nTests; i++) {
+      const collection::test_info &info = get<collection>().get_test(i);
+      if (info.m_skip || info.m_replay || info.m_result == logger::epending) {
+        continue;
       }
+
+      repeat_record &record = records[size_t(i)];
+      record.runs++;
+      if (info.gave_expected_result()) {
+        record.passes++;
+      } else {
+        failed = true;
+      }
+      record.durations.push_back(info.m_duration);
     }
+
+    // if we received a fatal error then no further rounds are run
+    if (fatal || (m_repeatUntilFail && failed)) break;
+    if ((m_repeatCount > 0) && (numRounds >= m_repeatCount)) break;
   }
+
+  // a test passes if it passed every time it ran
+  int32_t numPassed = 0;
+  int32_t numExpected = 0;
+  for (int32_t i = 0; i < nTests; i++) {
+    const collection::test_info &info = get<collection>().get_test(i);
+    const repeat_record &record = records[size_t(i)];
+    if (info.m_skip) continue;
+    if (info.m_replay) {
+      numPassed += info.gave_expected_result();
+    } else if ((record.runs > 0) && (record.passes == record.runs)) {
+      numPassed++;
+      numExpected += (info.m_expected != logger::epending);
+    }
+  }
+
+  if ((m_repeatCount != 1) || m_repeatUntilFail) {
+    report_repeats(records, numRounds);
+  }
+
   {
     logger log;
     auto successRate =
@@ -84,6 +483,14 @@ bool executor::run_all() {
       successRate = 99.f;
     }
     log.note("Passed %d/%d tests (%.0f%%)", numPassed, nTests, successRate);
+    if (numReplayed > 0) {
+      log.note("%d results were replayed from the results cache",
+               numReplayed);
+    }
+    if (numExpected > 0) {
+      log.note("%d tests gave the result expected by the csv file",
+               numExpected);
+    }
   }
   return (numPassed == nTests);
 }
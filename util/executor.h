@@ -10,6 +10,9 @@
 #define __SYCLCTS_UTIL_EXECUTOR_H
 
 #include "singleton.h"
+#include "collection.h"
+#include "logger.h"
+#include "watchdog.h"
 
 namespace sycl_cts {
 namespace util {
@@ -19,12 +22,106 @@ namespace util {
  */
 class executor : public singleton<executor> {
  public:
+  /** constructor
+   */
+  executor();
+
+  /** set the number of tests which may execute concurrently
+   *  @param jobs, number of worker threads, 1 runs all tests in order
+   */
+  void set_job_count(int32_t jobs);
+
+  /** set the number of worker processes tests are executed in
+   *  @param workers, number of processes, 0 executes tests in this process
+   */
+  void set_worker_count(int32_t workers);
+
+  /** set the timeout of tests which do not specify their own
+   *  @param timeout, seconds a test may run for, <= 0 for no timeout
+   */
+  void set_default_timeout(int timeout);
+
+  /** set the order tests are started in, by default the name order
+   *  @param longestFirst, start the tests which took longest before first
+   *  @param failedFirst, start the tests which failed before first
+   */
+  void set_schedule(bool longestFirst, bool failedFirst);
+
+  /** set how many times the selected tests are run
+   *  @param count, number of rounds, 0 for no limit when untilFail is set
+   *  @param untilFail, stop after the first round in which a test failed
+   */
+  void set_repeat(int32_t count, bool untilFail);
+
+  /** return the number of seconds a test may run for, <= 0 if unlimited
+   */
+  int get_timeout(const collection::test_info &info) const;
+
   /** execute all tests currently in the collection
    */
   bool run_all();
+
+  /** construct a single test, execute it and emit its log
+   *  @return, the result the test finished with
+   */
+  logger::result run_test(collection::test_info &info);
+
+ protected:
+  /** execute a constructed test and emit its log
+   */
+  logger::result run_test(test_base &test);
+
+  /** execute every selected test once
+   *  @param firstRound, replay cached results, which is only done once
+   *  @param numReplayed, incremented for each replayed result
+   *  @return, false if a test reported a fatal error
+   */
+  bool run_round(bool firstRound, int32_t &numReplayed);
+
+  /** execute the given tests on a pool of worker threads
+   *  @param tests, indices into the collection of the tests to execute
+   *  @param numPassed, incremented for each passing test
+   *  @return, false if a test reported a fatal error
+   */
+  bool run_concurrent(const std::vector<int32_t> &tests,
+                      std::atomic<int32_t> &numPassed, watchdog &dog);
+
+  /** order tests using the history of earlier runs
+   */
+  void schedule(std::vector<int32_t> &tests) const;
+
+  /** report the result an earlier run recorded for a test, as held in
+   *  its m_result, without running it
+   */
+  logger::result replay(collection::test_info &info);
+
+  /** execute a single test while the watchdog enforces its timeout
+   */
+  logger::result run_watched(collection::test_info &info, watchdog &dog);
+
+  // number of tests which may execute concurrently
+  int32_t m_jobCount;
+
+  // number of worker processes, 0 if tests execute in this process
+  int32_t m_workerCount;
+
+  // timeout of tests which do not specify their own
+  int m_defaultTimeout;
+
+  // start the longest running tests first, so the last to finish are short
+  bool m_longestFirst;
+
+  // start the tests which failed in the previous run first
+  bool m_failedFirst;
+
+  // number of rounds to run, 0 for no limit
+  int32_t m_repeatCount;
+
+  // stop repeating once a test has failed
+  bool m_repeatUntilFail;
 };
 
 }  // namespace util
 }  // namespace sycl_cts
 
-#endif  // __SYCLCTS_UTIL_EXECUTOR_H
\ No newline at end of file
+#endif  // __SYCLCTS_UTIL_EXECUTOR_H
@@ -0,0 +1,59 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_HASH_H
+#define __SYCLCTS_UTIL_HASH_H
+
+#include <cstdint>
+
+#include "stl.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** starting value of a 64 bit FNV-1a hash
+ */
+static const uint64_t kFnvOffset = 14695981039346656037ull;
+
+/** fold bytes into a 64 bit FNV-1a hash
+ *  the hash is stable across platforms and runs, unlike std::hash
+ */
+inline uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+  const uint64_t prime = 1099511628211ull;
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= prime;
+  }
+  return hash;
+}
+
+/** fold a string into a 64 bit FNV-1a hash
+ */
+inline uint64_t fnv1a(uint64_t hash, const std::string &str) {
+  // include the terminator so that consecutive strings can't run together
+  return fnv1a(hash, str.c_str(), str.size() + 1);
+}
+
+/** scramble all bits of a hash into the low bits
+ *  FNV-1a hashes of names which only differ in their last characters share
+ *  their remainders modulo small numbers, so mix them before bucketing
+ */
+inline uint64_t mix64(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_HASH_H
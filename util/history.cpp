@@ -0,0 +1,90 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#include <cstdio>
+#include <map>
+
+#include "history.h"
+#include "collection.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** load a history file into the collection
+ *  each line holds the duration in seconds, 1 if the test failed and the
+ *  test name
+ */
+bool history::load(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    // there is no history yet
+    return true;
+  }
+
+  collection &tests = get<collection>();
+
+  // find tests by name
+  std::map<std::string, int32_t> index;
+  for (int32_t i = 0; i < tests.get_test_count(); i++) {
+    index[tests.get_test(i).m_name] = i;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    double duration = -1.0;
+    int failed = 0;
+    int nameStart = 0;
+    if (line.empty() || line[0] == '#') continue;
+    if (sscanf(line.c_str(), "%lf %d %n", &duration, &failed, &nameStart) <
+            2 ||
+        nameStart <= 0) {
+      return false;
+    }
+
+    // tests which no longer exist are dropped
+    auto it = index.find(line.substr(size_t(nameStart)));
+    if (it == index.end()) continue;
+
+    collection::test_info &info = tests.get_test(it->second);
+    info.m_duration = duration;
+    info.m_failedBefore = (failed != 0);
+  }
+  return true;
+}
+
+/** write the history of every test in the collection to a file
+ */
+bool history::save(const std::string &path) {
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file.is_open()) return false;
+
+  file << "# sycl cts test history: seconds failed name\n";
+
+  collection &tests = get<collection>();
+  for (int32_t i = 0; i < tests.get_test_count(); i++) {
+    const collection::test_info &info = tests.get_test(i);
+
+    // tests which never ran have no history to record
+    if (info.m_duration < 0.0) continue;
+
+    // tests which did not run this time keep their earlier failure status,
+    // a test giving the result the csv file expects has not failed
+    bool failed = info.m_failedBefore;
+    if (info.m_result != logger::epending) {
+      failed = !info.gave_expected_result();
+    }
+
+    char duration[32];
+    snprintf(duration, sizeof(duration), "%.6f", info.m_duration);
+    file << duration << " " << (failed ? 1 : 0) << " " << info.m_name << "\n";
+  }
+  return bool(file);
+}
+
+}  // namespace util
+}  // namespace sycl_cts
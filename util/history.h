@@ -0,0 +1,39 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_HISTORY_H
+#define __SYCLCTS_UTIL_HISTORY_H
+
+#include "stl.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** durations and failures of the tests in earlier runs
+ *
+ *  the history is loaded into the collection before tests are scheduled,
+ *  and the durations and results of the tests that ran are written back
+ *  once the run has finished.
+ */
+class history {
+ public:
+  /** load a history file into the collection
+   *  a missing file is treated as an empty history
+   *  @return, false if the file exists but could not be read
+   */
+  static bool load(const std::string &path);
+
+  /** write the history of every test in the collection to a file
+   */
+  static bool save(const std::string &path);
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_HISTORY_H
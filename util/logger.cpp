@@ -52,12 +52,27 @@ void logger::skip(const std::string &str) {
   get<printer>().write(m_logId, printer::epacket::note, str);
 }
 
+/** notify a test has exceeded its timeout
+ *  @param seconds, the timeout the test exceeded
+ */
+void logger::timeout(int seconds) {
+  m_result = logger::etimeout;
+  get<printer>().write(m_logId, printer::epacket::note,
+                       "Test exceeded its timeout of " +
+                           std::to_string(seconds) + " seconds");
+}
+
 /** report fatal error and abort program
  *  @param reason, optional descriptive string for fatal error
  */
 void logger::fatal(const std::string &str) {
   m_result = logger::efatal;
   get<printer>().write(m_logId, printer::epacket::note, str);
+
+  // make sure the reason is written out should the process not survive,
+  // including anything the calling thread has captured so far
+  get<printer>().flush_capture();
+  get<printer>().finish();
 }
 
 /** output verbose information
@@ -102,6 +117,58 @@ void logger::note(const char *fmt, ...) {
   get<printer>().write(m_logId, printer::epacket::note, std::string(buffer));
 }
 
+/** format a duration in seconds
+ */
+static std::string format_seconds(double seconds) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.6f", seconds);
+  return std::string(buffer);
+}
+
+/** report the time taken by a test
+ */
+void logger::timing(const time_sample &start, const time_sample &setup,
+                    const time_sample &run, const time_sample &end,
+                    bool cpu) {
+  printer &out = get<printer>();
+  out.write(m_logId, printer::epacket::timing_wall,
+            format_seconds(end.m_wall - start.m_wall));
+  if (cpu) {
+    out.write(m_logId, printer::epacket::timing_user,
+              format_seconds(end.m_user - start.m_user));
+    out.write(m_logId, printer::epacket::timing_system,
+              format_seconds(end.m_system - start.m_system));
+  }
+  out.write(m_logId, printer::epacket::timing_setup,
+            format_seconds(setup.m_wall - start.m_wall));
+  out.write(m_logId, printer::epacket::timing_run,
+            format_seconds(run.m_wall - setup.m_wall));
+  out.write(m_logId, printer::epacket::timing_cleanup,
+            format_seconds(end.m_wall - run.m_wall));
+}
+
+/** report the memory used by a test
+ */
+void logger::memory(const memory_sample &start, const memory_sample &end) {
+  printer &out = get<printer>();
+  if (start.m_rss >= 0 && end.m_rss >= 0) {
+    out.write(m_logId, printer::epacket::memory_rss,
+              std::to_string(end.m_rss - start.m_rss));
+  }
+  if (end.m_peakRss >= 0) {
+    out.write(m_logId, printer::epacket::memory_peak,
+              std::to_string(end.m_peakRss));
+  }
+  if (allocation_tracking_enabled()) {
+    out.write(m_logId, printer::epacket::memory_allocations,
+              std::to_string(end.m_allocations - start.m_allocations));
+    out.write(m_logId, printer::epacket::memory_allocated,
+              std::to_string(end.m_allocatedBytes - start.m_allocatedBytes));
+    out.write(m_logId, printer::epacket::memory_frees,
+              std::to_string(end.m_frees - start.m_frees));
+  }
+}
+
 /** send a progress report
  */
 void logger::progress(int item, int total) {
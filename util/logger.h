@@ -11,6 +11,8 @@
 
 #include "stl.h"
 #include "test_base.h"
+#include "timing.h"
+#include "memory.h"
 
 namespace sycl_cts {
 namespace util {
@@ -51,6 +53,11 @@ class logger {
    */
   void skip(const std::string &reason = std::string());
 
+  /** notify a test has exceeded its timeout
+   *  @param seconds, the timeout the test exceeded
+   */
+  void timeout(int seconds);
+
   /** report fatal error and abort program
    */
   void fatal(const std::string &reason = std::string());
@@ -71,6 +78,22 @@ class logger {
    */
   void test_end();
 
+  /** report the time taken by a test
+   *  @param start, sampled before the test was set up
+   *  @param setup, sampled once the test was set up
+   *  @param run, sampled once the test had run
+   *  @param end, sampled once the test had cleaned up
+   *  @param cpu, false if the cpu times are not those of the test alone
+   */
+  void timing(const time_sample &start, const time_sample &setup,
+              const time_sample &run, const time_sample &end, bool cpu);
+
+  /** report the memory used by a test
+   *  @param start, sampled before the test was set up
+   *  @param end, sampled once the test had cleaned up
+   */
+  void memory(const memory_sample &start, const memory_sample &end);
+
   /** send a progress update
    *
    *  sent as number of 'items' done of 'total'
@@ -0,0 +1,150 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "memory.h"
+
+/** allocation counters of each thread
+ *  plain thread locals need no construction, so they are safe to touch from
+ *  within operator new itself
+ */
+namespace {
+thread_local int64_t tAllocations = 0;
+thread_local int64_t tAllocatedBytes = 0;
+thread_local int64_t tFrees = 0;
+}
+
+#if defined(SYCL_CTS_TRACK_ALLOCATIONS)
+
+/** replaced global allocation functions counting host allocations
+ *  the array and nothrow forms forward to these in the standard library
+ */
+void *operator new(std::size_t size) {
+  void *ptr = std::malloc(size ? size : 1);
+  if (ptr == nullptr) throw std::bad_alloc();
+  tAllocations++;
+  tAllocatedBytes += int64_t(size);
+  return ptr;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr) return;
+  tFrees++;
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+  operator delete(ptr);
+}
+
+#endif  // SYCL_CTS_TRACK_ALLOCATIONS
+
+namespace sycl_cts {
+namespace util {
+
+#if defined(__linux__)
+
+/** read a size given in kB from /proc/self/status
+ */
+static int64_t read_status_kb(const char *key) {
+  FILE *file = fopen("/proc/self/status", "r");
+  if (file == nullptr) return -1;
+
+  int64_t value = -1;
+  char line[256];
+  const size_t keyLength = strlen(key);
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (strncmp(line, key, keyLength) == 0 && line[keyLength] == ':') {
+      long long kb = 0;
+      if (sscanf(line + keyLength + 1, "%lld", &kb) == 1) {
+        value = int64_t(kb) * 1024;
+      }
+      break;
+    }
+  }
+  fclose(file);
+  return value;
+}
+
+/** read the resident set size from /proc/self/statm
+ */
+static int64_t read_rss() {
+  FILE *file = fopen("/proc/self/statm", "r");
+  if (file == nullptr) return -1;
+
+  long long size = 0;
+  long long resident = 0;
+  const bool ok = (fscanf(file, "%lld %lld", &size, &resident) == 2);
+  fclose(file);
+  return ok ? int64_t(resident) * int64_t(sysconf(_SC_PAGESIZE)) : -1;
+}
+
+#endif  // __linux__
+
+/** sample the memory use of the process
+ */
+memory_sample sample_memory() {
+  memory_sample sample;
+
+#if defined(__linux__)
+  sample.m_rss = read_rss();
+  sample.m_peakRss = read_status_kb("VmHWM");
+#else
+  sample.m_rss = -1;
+  sample.m_peakRss = -1;
+#endif
+
+  sample.m_allocations = tAllocations;
+  sample.m_allocatedBytes = tAllocatedBytes;
+  sample.m_frees = tFrees;
+  return sample;
+}
+
+/** restart tracking of the peak resident set size
+ */
+void reset_peak_memory() {
+#if defined(__linux__)
+  // writing 5 resets VmHWM to the current resident set size
+  FILE *file = fopen("/proc/self/clear_refs", "w");
+  if (file != nullptr) {
+    fputs("5", file);
+    fclose(file);
+  }
+#endif
+}
+
+/** return true if host allocations are being counted
+ */
+bool allocation_tracking_enabled() {
+#if defined(SYCL_CTS_TRACK_ALLOCATIONS)
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace util
+}  // namespace sycl_cts
@@ -0,0 +1,55 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_MEMORY_H
+#define __SYCLCTS_UTIL_MEMORY_H
+
+#include <cstdint>
+
+namespace sycl_cts {
+namespace util {
+
+/** the memory use of the process at a point during execution
+ *  sizes are given in bytes, -1 where the platform can't report them
+ */
+struct memory_sample {
+  // resident set size of the process
+  int64_t m_rss;
+
+  // highest resident set size since the peak was last reset
+  int64_t m_peakRss;
+
+  // host allocations made by the calling thread through operator new
+  int64_t m_allocations;
+
+  // bytes requested by those allocations
+  int64_t m_allocatedBytes;
+
+  // host allocations released by the calling thread through operator delete
+  int64_t m_frees;
+};
+
+/** sample the memory use of the process
+ *  allocations are only counted when built with SYCL_CTS_TRACK_ALLOCATIONS
+ */
+memory_sample sample_memory();
+
+/** restart tracking of the peak resident set size, where supported
+ *  the peak is shared by the whole process, so it only belongs to one test
+ *  while tests run one at a time
+ */
+void reset_peak_memory();
+
+/** return true if host allocations are being counted
+ */
+bool allocation_tracking_enabled();
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_MEMORY_H
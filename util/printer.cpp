@@ -11,16 +11,59 @@
 #endif
 
 #include <stdarg.h>
+#include <algorithm>
 #include <iostream>
 #include <assert.h>
 #include <cstdio>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <fcntl.h>
+
+#if defined(_MSC_VER)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "printer.h"
 #include "logger.h"
+#include "ring_buffer.h"
 
 namespace sycl_cts {
 namespace util {
 
+namespace {
+/** replace the bytes which are not printable ascii so a log stays readable
+ */
+std::string sanitize(const std::string &in) {
+  std::string t = std::string(in);
+  for (uint32_t i = 0; i < t.length(); i++) {
+    char &ch = t[i];
+    if (ch < 0x20 || ch >= 0x7f) ch = '.';
+  }
+  return t;
+}
+
+/** write all of the given bytes to a file descriptor, retrying on partial
+ *  writes
+ */
+void write_all(int fd, const std::string &bytes) {
+  const char *data = bytes.data();
+  size_t remaining = bytes.size();
+  while (remaining > 0) {
+#if defined(_MSC_VER)
+    const int written = _write(fd, data, static_cast<unsigned int>(remaining));
+#else
+    const ssize_t written = ::write(fd, data, remaining);
+#endif
+    if (written <= 0) return;
+    data += written;
+    remaining -= size_t(written);
+  }
+}
+}  // namespace
+
 /** standard output channel
  */
 class stdout_channel : public printer::channel {
@@ -41,6 +84,13 @@ class stdout_channel : public printer::channel {
     }
   }
 
+  virtual void write_raw(const std::string &bytes) {
+    if (!bytes.empty()) {
+      std::lock_guard<std::mutex> lock(m_outputMutex);
+      std::cout.write(bytes.data(), bytes.size());
+    }
+  }
+
   virtual void flush() { fflush(stdout); }
 };
 
@@ -72,15 +122,6 @@ class file_channel : public printer::channel {
     }
   }
 
-  std::string sanitize(const std::string &in) {
-    std::string t = std::string(in);
-    for (uint32_t i = 0; i < t.length(); i++) {
-      char &ch = t[i];
-      if (ch < 0x20 || ch >= 0x7f) ch = '.';
-    }
-    return t;
-  }
-
   virtual void write(const std::string &msg) {
     std::string t = sanitize(msg);
     if (t.empty() || m_file == nullptr)
@@ -104,11 +145,266 @@ class file_channel : public printer::channel {
     }
   }
 
+  virtual void write_raw(const std::string &bytes) {
+    if (bytes.empty() || m_file == nullptr)
+      return;
+    else {
+      std::lock_guard<std::mutex> lock(m_outputMutex);
+      fwrite(bytes.data(), 1, bytes.size(), m_file);
+      fflush(m_file);
+    }
+  }
+
   virtual void flush() {
     if (m_file != nullptr) fflush(m_file);
   }
 };
 
+/** asynchronous file output channel
+ *  producers hand each message to a lock-free ring buffer and a background
+ *  thread drains it into the file, batching many messages per write.
+ */
+class async_file_channel : public printer::channel {
+  // number of messages which can be queued before producers must wait
+  static const size_t kCapacity = 4096;
+
+  // number of bytes gathered before they are written out
+  static const size_t kBatchSize = 64 * 1024;
+
+  ring_buffer<std::string> m_queue;
+  int m_fd;
+
+  // number of messages written out by the background thread
+  std::atomic<size_t> m_written;
+
+  // set when the background thread should exit once drained
+  std::atomic<bool> m_stop;
+
+  // set while the background thread is waiting for messages
+  std::atomic<bool> m_idle;
+
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_drained;
+  std::thread m_thread;
+
+  /* background thread draining the queue into the file */
+  void drain() {
+    std::string batch;
+    std::string msg;
+    for (;;) {
+      size_t popped = 0;
+      while (batch.size() < kBatchSize && m_queue.try_pop(msg)) {
+        batch += msg;
+        popped++;
+      }
+
+      if (!batch.empty()) {
+        write_all(m_fd, batch);
+        batch.clear();
+      }
+
+      if (popped > 0) {
+        m_written.fetch_add(popped);
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_drained.notify_all();
+        continue;
+      }
+
+      if (m_stop && m_written.load() == m_queue.pushed()) break;
+
+      // nothing to do, sleep until a producer wakes us up
+      std::unique_lock<std::mutex> lock(m_wakeMutex);
+      m_idle = true;
+      m_wake.wait_for(lock, std::chrono::milliseconds(10));
+      m_idle = false;
+    }
+  }
+
+  /* queue a message, waiting for space if the queue is full */
+  void push(std::string msg) {
+    while (!m_queue.try_push(msg)) {
+      wake();
+      std::this_thread::yield();
+    }
+    if (m_idle) wake();
+  }
+
+  void wake() {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_wake.notify_one();
+  }
+
+ public:
+  async_file_channel()
+      : m_queue(kCapacity),
+        m_fd(-1),
+        m_written(0),
+        m_stop(false),
+        m_idle(false),
+        m_wakeMutex(),
+        m_wake(),
+        m_drained(),
+        m_thread() {}
+
+  ~async_file_channel() { close(); }
+
+  bool open(const char *path) {
+    close();
+#if defined(_MSC_VER)
+    m_fd = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+#else
+    m_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (m_fd < 0) return false;
+
+    m_stop = false;
+    m_thread = std::thread(&async_file_channel::drain, this);
+    return true;
+  }
+
+  void close() {
+    if (m_thread.joinable()) {
+      m_stop = true;
+      wake();
+      m_thread.join();
+    }
+    if (m_fd >= 0) {
+#if defined(_MSC_VER)
+      _close(m_fd);
+#else
+      ::close(m_fd);
+#endif
+      m_fd = -1;
+    }
+  }
+
+  virtual void write(const std::string &msg) {
+    std::string t = sanitize(msg);
+    if (t.empty() || m_fd < 0) return;
+    push(std::move(t));
+  }
+
+  virtual void writeln(const std::string &msg) {
+    std::string t = sanitize(msg);
+    if (t.empty() || m_fd < 0) return;
+    t += "\n";
+    push(std::move(t));
+  }
+
+  virtual void write_raw(const std::string &bytes) {
+    if (bytes.empty() || m_fd < 0) return;
+    push(bytes);
+  }
+
+  /* wait until everything queued so far has been written out */
+  virtual void flush() {
+    if (!m_thread.joinable()) return;
+    const size_t target = m_queue.pushed();
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (m_written.load() < target) {
+      m_wake.notify_one();
+      m_drained.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+};
+
+/** file descriptor output channel
+ */
+class fd_channel : public printer::channel {
+  std::mutex m_outputMutex;
+  int m_fd;
+
+ public:
+  fd_channel() : m_outputMutex(), m_fd(-1) {}
+
+  void open(int fd) {
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    m_fd = fd;
+  }
+
+  virtual void write(const std::string &msg) {
+    std::string t = sanitize(msg);
+    if (t.empty() || m_fd < 0)
+      return;
+    else {
+      std::lock_guard<std::mutex> lock(m_outputMutex);
+      write_all(m_fd, t);
+    }
+  }
+
+  virtual void writeln(const std::string &msg) {
+    std::string t = sanitize(msg);
+    if (t.empty() || m_fd < 0)
+      return;
+    else {
+      std::lock_guard<std::mutex> lock(m_outputMutex);
+      write_all(m_fd, t + "\n");
+    }
+  }
+
+  virtual void write_raw(const std::string &bytes) {
+    if (bytes.empty() || m_fd < 0)
+      return;
+    else {
+      std::lock_guard<std::mutex> lock(m_outputMutex);
+      write_all(m_fd, bytes);
+    }
+  }
+
+  virtual void flush() {}
+};
+
+/** channel recording output so that it can be written out later as a block
+ */
+class capture_channel : public printer::channel {
+  enum ekind { ewrite = 0, ewriteln, eraw };
+
+  // the recording thread and flush_captures() may use the channel at once
+  std::mutex m_linesMutex;
+
+  // recorded messages and how they were written
+  std::vector<std::pair<std::string, ekind>> m_lines;
+
+ public:
+  virtual void write(const std::string &msg) {
+    std::lock_guard<std::mutex> lock(m_linesMutex);
+    m_lines.push_back(std::make_pair(msg, ewrite));
+  }
+
+  virtual void writeln(const std::string &msg) {
+    std::lock_guard<std::mutex> lock(m_linesMutex);
+    m_lines.push_back(std::make_pair(msg, ewriteln));
+  }
+
+  virtual void write_raw(const std::string &bytes) {
+    std::lock_guard<std::mutex> lock(m_linesMutex);
+    m_lines.push_back(std::make_pair(bytes, eraw));
+  }
+
+  virtual void flush() {}
+
+  /* replay all recorded messages over another channel */
+  void replay(printer::channel &out) {
+    std::lock_guard<std::mutex> lock(m_linesMutex);
+    for (const auto &line : m_lines) {
+      switch (line.second) {
+        case (ewrite):
+          out.write(line.first);
+          break;
+        case (ewriteln):
+          out.writeln(line.first);
+          break;
+        case (eraw):
+          out.write_raw(line.first);
+          break;
+      }
+    }
+    m_lines.clear();
+  }
+};
+
 /** JSON printer
  */
 class json_formatter : public printer::formatter {
@@ -131,6 +427,64 @@ class json_formatter : public printer::formatter {
   }
 };
 
+/** compact binary printer
+ *  each packet is written as a little endian record:
+ *    uint32  size of the rest of the record in bytes
+ *    int32   log id
+ *    uint8   packet type
+ *    uint8   payload kind, 0 for a string and 1 for an int32
+ *    uint64  microseconds since the printer was created
+ *    ...     payload, the string bytes or an int32
+ */
+class binary_formatter : public printer::formatter {
+  enum ekind { estring = 0, eint };
+
+  // size of the fields following the record size
+  static const uint32_t kHeaderSize = 4 + 1 + 1 + 8;
+
+  std::chrono::steady_clock::time_point m_start;
+
+  static void put(std::string &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+      out += char((value >> (i * 8)) & 0xff);
+    }
+  }
+
+  void write_record(printer::channel &out, int32_t id, printer::epacket packet,
+                    ekind kind, const char *payload, uint32_t size) {
+    const uint64_t micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_start)
+            .count();
+
+    std::string record;
+    record.reserve(4 + kHeaderSize + size);
+    put(record, kHeaderSize + size, 4);
+    put(record, uint32_t(id), 4);
+    put(record, uint8_t(packet), 1);
+    put(record, uint8_t(kind), 1);
+    put(record, micros, 8);
+    record.append(payload, size);
+    out.write_raw(record);
+  }
+
+ public:
+  binary_formatter() : m_start(std::chrono::steady_clock::now()) {}
+
+  virtual void write(printer::channel &out, int32_t id, printer::epacket packet,
+                     const std::string &data) {
+    write_record(out, id, packet, estring, data.data(),
+                 uint32_t(data.size()));
+  }
+
+  virtual void write(printer::channel &out, int32_t id, printer::epacket packet,
+                     int data) {
+    std::string payload;
+    put(payload, uint32_t(data), 4);
+    write_record(out, id, packet, eint, payload.data(), 4);
+  }
+};
+
 /** human readable text printer
  */
 class text_formatter : public printer::formatter {
@@ -154,6 +508,39 @@ class text_formatter : public printer::formatter {
       case (printer::list_test_count):
         out.writeln(data + " tests in executable");
         return;
+      case (printer::timing_wall):
+        out.writeln("  . time: " + data + "s wall");
+        return;
+      case (printer::timing_user):
+        out.writeln("  . time: " + data + "s user");
+        return;
+      case (printer::timing_system):
+        out.writeln("  . time: " + data + "s system");
+        return;
+      case (printer::timing_setup):
+        out.writeln("  . time: " + data + "s setup");
+        return;
+      case (printer::timing_run):
+        out.writeln("  . time: " + data + "s run");
+        return;
+      case (printer::timing_cleanup):
+        out.writeln("  . time: " + data + "s cleanup");
+        return;
+      case (printer::memory_rss):
+        out.writeln("  . memory: " + data + " bytes rss change");
+        return;
+      case (printer::memory_peak):
+        out.writeln("  . memory: " + data + " bytes peak rss");
+        return;
+      case (printer::memory_allocations):
+        out.writeln("  . memory: " + data + " allocations");
+        return;
+      case (printer::memory_allocated):
+        out.writeln("  . memory: " + data + " bytes allocated");
+        return;
+      case (printer::memory_frees):
+        out.writeln("  . memory: " + data + " frees");
+        return;
     }
     out.writeln(data);
   }
@@ -175,6 +562,9 @@ class text_formatter : public printer::formatter {
           case (logger::efatal):
             out.writeln("  - fatal\n");
             break;
+          case (logger::etimeout):
+            out.writeln("  - timeout\n");
+            break;
         }
       }
         return;
@@ -194,8 +584,24 @@ class text_formatter : public printer::formatter {
 namespace {
 stdout_channel gStdoutChannel;
 file_channel gFileChannel;
+async_file_channel gAsyncFileChannel;
+fd_channel gFdChannel;
 json_formatter gJsonFormat;
 text_formatter gTextFormat;
+binary_formatter gBinaryFormat;
+
+// capture channel of the calling thread, if it is capturing
+thread_local std::unique_ptr<capture_channel> tCaptureChannel;
+
+// capture channels of all capturing threads, guarded by m_captureMutex
+std::vector<capture_channel *> gCaptureChannels;
+
+/** return the channel the calling thread should write to
+ */
+printer::channel *select_channel(printer::channel *channel) {
+  if (tCaptureChannel) return tCaptureChannel.get();
+  return channel;
+}
 };
 
 /** constructor
@@ -224,6 +630,9 @@ void printer::set_format(printer::eformat fmt) {
     case (printer::eformat::etext):
       m_formatter = &gTextFormat;
       break;
+    case (printer::eformat::ebinary):
+      m_formatter = &gBinaryFormat;
+      break;
     default:
       assert(!"Unknown printer format");
   }
@@ -237,16 +646,33 @@ bool printer::set_file_channel(const char *path) {
   return true;
 }
 
+/** redirect the printer to write to a file through a background thread
+ */
+bool printer::set_async_file_channel(const char *path) {
+  if (!gAsyncFileChannel.open(path)) return false;
+  m_channel = &gAsyncFileChannel;
+  return true;
+}
+
+/** redirect the printer to write to an open file descriptor
+ */
+void printer::set_fd_channel(int fd) {
+  gFdChannel.open(fd);
+  m_channel = &gFdChannel;
+}
+
 /** write a packet using the set formatter and channel
  */
 void printer::write(int32_t id, epacket packet, std::string data) {
-  if (m_formatter) m_formatter->write(*m_channel, id, packet, data);
+  if (m_formatter)
+    m_formatter->write(*select_channel(m_channel), id, packet, data);
 }
 
 /** write a packet using the set formatter and channel
  */
 void printer::write(int32_t id, epacket packet, int data) {
-  if (m_formatter) m_formatter->write(*m_channel, id, packet, data);
+  if (m_formatter)
+    m_formatter->write(*select_channel(m_channel), id, packet, data);
 }
 
 /** global printf
@@ -265,14 +691,60 @@ void printer::print(const char *fmt, ...) {
   // enforce terminal character
   buffer[sizeof(buffer) - 1] = '\0';
 
-  // output string via channel
-  if (m_channel) m_channel->write(std::string(buffer));
+  print(std::string(buffer));
 }
 
 /** global print
+ *  free-form text would corrupt a binary log, so it goes to stderr instead
  */
 void printer::print(const std::string &str) {
-  if (m_channel) m_channel->write(str);
+  if (m_formatter == &gBinaryFormat) {
+    std::cerr << str;
+  } else if (m_channel) {
+    select_channel(m_channel)->write(str);
+  }
+}
+
+/** start capturing the output of the calling thread
+ */
+void printer::begin_capture() {
+  assert(!tCaptureChannel);
+  tCaptureChannel.reset(new capture_channel());
+
+  std::lock_guard<std::mutex> lock(m_captureMutex);
+  gCaptureChannels.push_back(tCaptureChannel.get());
+}
+
+/** stop capturing and write out the captured block in one go
+ */
+void printer::end_capture() {
+  assert(tCaptureChannel);
+  std::unique_ptr<capture_channel> captured(std::move(tCaptureChannel));
+
+  std::lock_guard<std::mutex> lock(m_captureMutex);
+  gCaptureChannels.erase(std::find(gCaptureChannels.begin(),
+                                   gCaptureChannels.end(), captured.get()));
+  if (m_channel) captured->replay(*m_channel);
+}
+
+/** write out what the calling thread has captured so far, it keeps
+ *  capturing
+ */
+void printer::flush_capture() {
+  if (!tCaptureChannel) return;
+  std::lock_guard<std::mutex> lock(m_captureMutex);
+  if (m_channel) tCaptureChannel->replay(*m_channel);
+}
+
+/** write out what every capturing thread has captured so far, the threads
+ *  keep capturing
+ */
+void printer::flush_captures() {
+  std::lock_guard<std::mutex> lock(m_captureMutex);
+  if (!m_channel) return;
+  for (capture_channel *captured : gCaptureChannels) {
+    captured->replay(*m_channel);
+  }
 }
 
 /** finish all writing operations
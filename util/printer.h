@@ -21,7 +21,7 @@ namespace util {
  */
 class printer : public singleton<printer> {
  public:
-  enum eformat { ejson = 0, etext };
+  enum eformat { ejson = 0, etext, ebinary };
 
   enum epacket {
     /* test attributes */
@@ -40,6 +40,21 @@ class printer : public singleton<printer> {
     /* test listing */
     list_test_name,
     list_test_count,
+
+    /* test timing, in seconds */
+    timing_wall,
+    timing_user,
+    timing_system,
+    timing_setup,
+    timing_run,
+    timing_cleanup,
+
+    /* test memory use, in bytes */
+    memory_rss,
+    memory_peak,
+    memory_allocations,
+    memory_allocated,
+    memory_frees,
   };
 
   /** a string output channel
@@ -54,6 +69,9 @@ class printer : public singleton<printer> {
     /* output string with newline */
     virtual void writeln(const std::string &msg) = 0;
 
+    /* output bytes exactly as given, without sanitizing them */
+    virtual void write_raw(const std::string &bytes) = 0;
+
     /* flush the output channel */
     virtual void flush() = 0;
   };
@@ -93,6 +111,16 @@ class printer : public singleton<printer> {
    */
   bool set_file_channel(const char *m_path);
 
+  /** redirect the printer to write to a file from a background thread,
+   *  so that writing a packet never waits on the file system
+   */
+  bool set_async_file_channel(const char *m_path);
+
+  /** redirect the printer to write to an open file descriptor, such as
+   *  the pipe a forked worker process reports back over
+   */
+  void set_fd_channel(int fd);
+
   /** write a packet to the printer
    */
   void write(int32_t id, epacket packet, std::string data);
@@ -101,12 +129,32 @@ class printer : public singleton<printer> {
    */
   void write(int32_t id, epacket packet, int data);
 
+  /** capture all packets written by the calling thread until end_capture()
+   *  is called, so the output of concurrently running tests can't interleave
+   */
+  void begin_capture();
+
+  /** write out everything captured by the calling thread as one block
+   */
+  void end_capture();
+
+  /** write out what the calling thread has captured so far without ending
+   *  the capture, does nothing if the thread is not capturing
+   */
+  void flush_capture();
+
+  /** write out what every capturing thread has captured so far, for when
+   *  the process is about to end before they call end_capture()
+   */
+  void flush_captures();
+
   /** instruct the printer to finish all printing
    *  operations. importantly, this terminates the root JSON object
    */
   virtual void finish();
 
   /** global stdout printing functions
+   *  with the binary format the text is written to stderr
    */
   void print(const char *fstr, ...);
   void print(const std::string &str);
@@ -120,6 +168,9 @@ class printer : public singleton<printer> {
 
   // the output channel to use
   channel *m_channel;
+
+  // serializes the output of captured blocks
+  std::mutex m_captureMutex;
 };
 
 }  // namespace util
@@ -0,0 +1,138 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#include <deque>
+#include <map>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+#include "profiler.h"
+
+namespace sycl_cts {
+namespace util {
+
+namespace {
+/** return the kernels recorded by the calling thread
+ */
+std::map<std::string, kernel_profiler::kernel_stats> &thread_record() {
+  static thread_local std::map<std::string, kernel_profiler::kernel_stats>
+      record;
+  return record;
+}
+
+/** return the kernels of the calling thread waiting to be recorded
+ */
+std::deque<std::function<void()>> &thread_pending() {
+  static thread_local std::deque<std::function<void()>> pending;
+  return pending;
+}
+
+/** return the name given by the innermost kernel_name_scope of the calling
+ *  thread, empty if there is none
+ */
+std::string &thread_kernel_name() {
+  static thread_local std::string name;
+  return name;
+}
+
+// the kernels deferred before the oldest is recorded, so that tests
+// submitting many kernels do not hold on to all of their events
+const size_t maxPending = 1024;
+
+/** return the time between two timestamps, 0 if they are out of order
+ */
+uint64_t elapsed(uint64_t from, uint64_t to) {
+  return (to > from) ? to - from : 0;
+}
+}  // namespace
+
+/** record one execution of a kernel
+ */
+void kernel_profiler::record(const std::string &name, uint64_t submit,
+                             uint64_t start, uint64_t end) {
+  auto &record = thread_record();
+  auto it = record.find(name);
+  if (it == record.end()) {
+    kernel_stats stats = {name, 0, 0, 0};
+    it = record.insert(std::make_pair(name, stats)).first;
+  }
+
+  kernel_stats &stats = it->second;
+  stats.m_count++;
+  stats.m_queued += elapsed(submit, start);
+  stats.m_executing += elapsed(start, end);
+}
+
+/** record a kernel once the test has finished
+ */
+void kernel_profiler::defer(std::function<void()> read) {
+  auto &pending = thread_pending();
+  if (pending.size() >= maxPending) {
+    pending.front()();
+    pending.pop_front();
+  }
+  pending.push_back(std::move(read));
+}
+
+/** return and clear the kernels recorded by the calling thread
+ */
+std::vector<kernel_profiler::kernel_stats> kernel_profiler::take() {
+  auto &pending = thread_pending();
+  while (!pending.empty()) {
+    pending.front()();
+    pending.pop_front();
+  }
+
+  auto &record = thread_record();
+
+  std::vector<kernel_stats> stats;
+  stats.reserve(record.size());
+  for (const auto &it : record) {
+    stats.push_back(it.second);
+  }
+  record.clear();
+  return stats;
+}
+
+/** return the name to record a kernel under
+ */
+std::string kernel_profiler::kernel_name(const std::type_info &type) {
+  const std::string &scoped = thread_kernel_name();
+  if (!scoped.empty()) {
+    return scoped;
+  }
+#if defined(__GNUG__)
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  if (status == 0 && demangled) {
+    std::string name(demangled);
+    std::free(demangled);
+    return name;
+  }
+#endif
+  return type.name();
+}
+
+/** name the kernels submitted by the calling thread
+ */
+kernel_name_scope::kernel_name_scope(std::string name)
+    : m_previous(std::move(thread_kernel_name())) {
+  thread_kernel_name() = std::move(name);
+}
+
+/** restore the name of the enclosing scope
+ */
+kernel_name_scope::~kernel_name_scope() {
+  thread_kernel_name() = std::move(m_previous);
+}
+
+}  // namespace util
+}  // namespace sycl_cts
@@ -0,0 +1,84 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_PROFILER_H
+#define __SYCLCTS_UTIL_PROFILER_H
+
+#include <cstdint>
+#include <functional>
+#include <typeinfo>
+
+#include "stl.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** device timestamps of the kernels executed by a test, grouped by name
+ *
+ *  kernels are recorded on the thread running the test, so tests which
+ *  execute concurrently keep separate records.
+ */
+class kernel_profiler {
+ public:
+  /** the total time spent by every execution of one kernel
+   *  times are given in nanoseconds
+   */
+  struct kernel_stats {
+    std::string m_name;
+    int32_t m_count;
+
+    // time from submission until the kernel started executing
+    uint64_t m_queued;
+
+    // time from the start to the end of execution on the device
+    uint64_t m_executing;
+  };
+
+  /** record one execution of a kernel from the profiling info of its event
+   *  @param submit, start, end, the command_submit, command_start and
+   *         command_end timestamps in nanoseconds
+   */
+  static void record(const std::string &name, uint64_t submit, uint64_t start,
+                     uint64_t end);
+
+  /** record a kernel once the test has finished, so that reading the
+   *  profiling info of its event does not wait for the kernel to complete
+   *  @param read, records the kernel when called
+   */
+  static void defer(std::function<void()> read);
+
+  /** return the kernels recorded by the calling thread in name order,
+   *  clearing the record
+   */
+  static std::vector<kernel_stats> take();
+
+  /** return the name of the innermost kernel_name_scope of the calling
+   *  thread, or the readable name of type if there is none
+   */
+  static std::string kernel_name(const std::type_info &type);
+};
+
+/** names the kernels submitted through the CTS queues by the calling thread
+ *  while in scope, such as by the signature of the builtin they test
+ */
+class kernel_name_scope {
+ public:
+  explicit kernel_name_scope(std::string name);
+  ~kernel_name_scope();
+
+  kernel_name_scope(const kernel_name_scope &) = delete;
+  kernel_name_scope &operator=(const kernel_name_scope &) = delete;
+
+ private:
+  std::string m_previous;
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_PROFILER_H
@@ -14,22 +14,36 @@
 namespace sycl_cts {
 namespace util {
 
+/** function constructing a test object on demand
+ */
+typedef test_base *(*test_factory)();
+
 // test harness function to register a given test
 // defined in collection.cpp
-extern void register_test(test_base *test);
+extern void register_test(const char *name, test_factory factory, int flags,
+                          int timeout);
 
 /** test proxy class
  *  this class is used to register tests with the test harness at compile time.
+ *  only the name and a factory are registered, the test object itself is
+ *  constructed when the test is about to run.
  */
 template <typename T>
 class test_proxy {
  public:
   /** test_proxy constructor
+   *  @param name, name of the test, which must match the one it reports
+   *  @param flags, test_base::eflags describing how the test is scheduled
+   *  @param timeout, seconds the test may run for, -1 for the default
    */
-  test_proxy() {
+  test_proxy(const char *name, int flags = test_base::enone,
+             int timeout = -1) {
     // use an externed function to cut dependency on the collection
-    register_test(new T());
+    register_test(name, &test_proxy::create, flags, timeout);
   }
+
+ private:
+  static test_base *create() { return new T(); }
 };
 
 }  // namespace util
@@ -0,0 +1,171 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <link.h>
+#define SYCL_CTS_HAS_DL_ITERATE_PHDR 1
+#endif
+
+#include "results_cache.h"
+#include "hash.h"
+
+namespace sycl_cts {
+namespace util {
+
+namespace {
+
+/** fold the contents of a file into a hash
+ */
+uint64_t hash_file_contents(uint64_t hash, const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) return fnv1a(hash, path);
+
+  std::vector<char> buffer(1 << 20);
+  size_t read;
+  while ((read = fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+    hash = fnv1a(hash, buffer.data(), read);
+  }
+  fclose(file);
+  return hash;
+}
+
+/** return the path, size and modification time of a file on one line
+ */
+std::string describe_file_identity(const std::string &path) {
+  std::string line = path;
+
+  struct stat info;
+  if (stat(path.c_str(), &info) == 0) {
+    line += " " + std::to_string(int64_t(info.st_size)) + " " +
+            std::to_string(int64_t(info.st_mtime));
+  }
+  return line + "\n";
+}
+
+#if defined(SYCL_CTS_HAS_DL_ITERATE_PHDR)
+/** collect the path of each shared library loaded by this process
+ */
+int collect_library(dl_phdr_info *info, size_t, void *data) {
+  auto *paths = static_cast<std::vector<std::string> *>(data);
+  if (info->dlpi_name != nullptr && info->dlpi_name[0] != '\0') {
+    paths->push_back(info->dlpi_name);
+  }
+  return 0;
+}
+#endif
+
+}  // namespace
+
+/** return the identity of each shared library loaded by this process
+ */
+std::string results_cache::describe_runtime_libraries() {
+  std::string description;
+#if defined(SYCL_CTS_HAS_DL_ITERATE_PHDR)
+  std::vector<std::string> paths;
+  dl_iterate_phdr(collect_library, &paths);
+
+  // the load order does not matter
+  std::sort(paths.begin(), paths.end());
+  for (const auto &path : paths) {
+    description += describe_file_identity(path);
+  }
+#endif
+  return description;
+}
+
+/** constructor
+ */
+results_cache::results_cache() : m_key(kFnvOffset), m_entries() {}
+
+/** compute the key of the current environment
+ */
+void results_cache::set_environment(const std::string &binaryPath,
+                                    const std::string &deviceInfo,
+                                    const std::string &options) {
+  uint64_t key = kFnvOffset;
+  key = hash_file_contents(key, binaryPath);
+  key = fnv1a(key, deviceInfo);
+  key = fnv1a(key, options);
+  m_key = key;
+}
+
+/** load the cache from a file
+ *  each line holds the key in hex, the result and the test name
+ */
+bool results_cache::load(const std::string &path) {
+  m_entries.clear();
+
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    // nothing has been cached yet
+    return true;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    unsigned long long key = 0;
+    int result = 0;
+    int nameStart = 0;
+    if (line.empty() || line[0] == '#') continue;
+    if (sscanf(line.c_str(), "%llx %d %n", &key, &result, &nameStart) < 2 ||
+        nameStart <= 0) {
+      return false;
+    }
+
+    entry e = {uint64_t(key), static_cast<logger::result>(result)};
+    m_entries[line.substr(size_t(nameStart))] = e;
+  }
+  return true;
+}
+
+/** write the cache to a file
+ */
+bool results_cache::save(const std::string &path) const {
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file.is_open()) return false;
+
+  file << "# sycl cts results cache: key result name\n";
+  for (const auto &it : m_entries) {
+    char key[32];
+    snprintf(key, sizeof(key), "%016llx",
+             static_cast<unsigned long long>(it.second.m_key));
+    file << key << " " << int(it.second.m_result) << " " << it.first << "\n";
+  }
+  return bool(file);
+}
+
+/** find a result recorded in the current environment
+ */
+bool results_cache::lookup(const std::string &name,
+                           logger::result &result) const {
+  auto it = m_entries.find(name);
+  if (it == m_entries.end() || it->second.m_key != m_key) {
+    return false;
+  }
+  result = it->second.m_result;
+  return true;
+}
+
+/** record the result of a test in the current environment
+ */
+void results_cache::store(const std::string &name, logger::result result) {
+  entry e = {m_key, result};
+  m_entries[name] = e;
+}
+
+}  // namespace util
+}  // namespace sycl_cts
@@ -0,0 +1,83 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_RESULTS_CACHE_H
+#define __SYCLCTS_UTIL_RESULTS_CACHE_H
+
+#include <map>
+
+#include "stl.h"
+#include "logger.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** on disk record of the last result of each test
+ *
+ *  every result is stored with a key hashing the test binary, the runtime
+ *  libraries it loaded, the identity of the device and the options which
+ *  change what the tests do, so a cached result is only trusted while none
+ *  of these have changed.
+ */
+class results_cache {
+ public:
+  /** constructor
+   */
+  results_cache();
+
+  /** compute the key of the current environment
+   *  @param binaryPath, path of the test executable
+   *  @param deviceInfo, description of the device and platform tests run on
+   *                     and of the runtime libraries loaded to query them
+   *  @param options, description of the options tests are run with
+   */
+  void set_environment(const std::string &binaryPath,
+                       const std::string &deviceInfo,
+                       const std::string &options);
+
+  /** return the path, size and modification time of each shared library
+   *  loaded by this process, which includes the SYCL runtime and, once a
+   *  device has been queried, the OpenCL ICD loader and vendor driver
+   */
+  static std::string describe_runtime_libraries();
+
+  /** load the cache from a file, a missing file leaves the cache empty
+   *  @return, false if the file exists but could not be read
+   */
+  bool load(const std::string &path);
+
+  /** write the cache to a file
+   */
+  bool save(const std::string &path) const;
+
+  /** find a result recorded in the current environment
+   *  @return, false if the test has no result for the current key
+   */
+  bool lookup(const std::string &name, logger::result &result) const;
+
+  /** record the result of a test in the current environment
+   */
+  void store(const std::string &name, logger::result result);
+
+ protected:
+  struct entry {
+    uint64_t m_key;
+    logger::result m_result;
+  };
+
+  // key of the current environment
+  uint64_t m_key;
+
+  // last recorded result of each test by name
+  std::map<std::string, entry> m_entries;
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_RESULTS_CACHE_H
@@ -0,0 +1,110 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_RING_BUFFER_H
+#define __SYCLCTS_UTIL_RING_BUFFER_H
+
+#include <cstdint>
+
+#include "stl.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** bounded lock-free queue for many producers and a single consumer
+ *
+ *  each slot carries a sequence number which tells producers and the
+ *  consumer whether the slot is free to write or ready to read, so neither
+ *  side ever takes a lock.
+ */
+template <typename T>
+class ring_buffer {
+ public:
+  /** constructor
+   *  @param capacity, number of slots, must be a power of two
+   */
+  explicit ring_buffer(size_t capacity)
+      : m_slots(new slot[capacity]),
+        m_mask(capacity - 1),
+        m_enqueuePos(0),
+        m_dequeuePos(0) {
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+    for (size_t i = 0; i < capacity; i++) {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /** try to add an item, moving from it on success
+   *  @return, false if the buffer is full
+   */
+  bool try_push(T &item) {
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      slot &s = m_slots[pos & m_mask];
+      const size_t seq = s.sequence.load(std::memory_order_acquire);
+      const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+      if (diff == 0) {
+        // the slot is free, try to claim it
+        if (m_enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          s.value = std::move(item);
+          s.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // the consumer has not yet read this slot
+        return false;
+      } else {
+        // another producer claimed the slot first
+        pos = m_enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** try to remove the oldest item
+   *  @return, false if the buffer is empty
+   */
+  bool try_pop(T &item) {
+    const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    slot &s = m_slots[pos & m_mask];
+    const size_t seq = s.sequence.load(std::memory_order_acquire);
+    if (intptr_t(seq) - intptr_t(pos + 1) < 0) {
+      // the slot has not been written yet
+      return false;
+    }
+    item = std::move(s.value);
+    m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    s.sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** return the number of items pushed so far
+   */
+  size_t pushed() const { return m_enqueuePos.load(std::memory_order_acquire); }
+
+ protected:
+  struct slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<slot[]> m_slots;
+  const size_t m_mask;
+
+  // producers and the consumer are kept on separate cache lines
+  alignas(64) std::atomic<size_t> m_enqueuePos;
+  alignas(64) std::atomic<size_t> m_dequeuePos;
+
+  // disable copy constructors
+  ring_buffer(const ring_buffer &);
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_RING_BUFFER_H
@@ -15,7 +15,10 @@ namespace util {
 /** constructor
  */
 selector::selector()
-    : m_platform(ctsplat::unknown), m_device(ctsdevice::unknown) {}
+    : m_platform(ctsplat::unknown),
+      m_device(ctsdevice::unknown),
+      m_sharedObjects(false),
+      m_profiling(false) {}
 
 void selector::set_default_platform(const std::string &name) {
   if (name == "host")
@@ -77,5 +80,21 @@ selector::ctsdevice selector::get_default_device() const {
   return m_device;
 }
 
+/** share the default SYCL objects between all tests of the process
+ */
+void selector::set_shared_objects(bool shared) { m_sharedObjects = shared; }
+
+/** return true if tests share their default SYCL objects
+ */
+bool selector::shared_objects() const { return m_sharedObjects; }
+
+/** profile the kernels executed on the CTS queues
+ */
+void selector::set_profiling(bool profiling) { m_profiling = profiling; }
+
+/** return true if kernel profiling is enabled
+ */
+bool selector::profiling() const { return m_profiling; }
+
 }  // namespace util
 }  // namespace sycl_cts
@@ -78,11 +78,33 @@ class selector : public singleton<selector> {
    */
   ctsplat get_default_platform() const;
 
+  /** share one device, context and queue between all tests of the process
+   *  rather than constructing new ones for each test
+   */
+  void set_shared_objects(bool shared);
+
+  /** return true if tests share their default SYCL objects
+   */
+  bool shared_objects() const;
+
+  /** create the CTS queues with the enable_profiling property and record
+   *  the device timestamps of the kernels tests run on them
+   */
+  void set_profiling(bool profiling);
+
+  /** return true if kernel profiling is enabled
+   */
+  bool profiling() const;
+
  protected:
   // default platform to select
   ctsplat m_platform;
   // default SYCL device type to use
   ctsdevice m_device;
+  // share the default SYCL objects between tests
+  bool m_sharedObjects;
+  // profile the kernels executed on the CTS queues
+  bool m_profiling;
 };
 
 }  // namespace util
@@ -0,0 +1,517 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#include "supervisor.h"
+#include "collection.h"
+#include "executor.h"
+#include "logger.h"
+#include "printer.h"
+
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SYCL_CTS_HAS_FORK 1
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace sycl_cts {
+namespace util {
+
+/** a worker process slot
+ */
+struct supervisor::worker {
+  // process id, or -1 if no process is running in this slot
+  int pid;
+
+  // pipe end used to hand tests to the worker
+  int cmdFd;
+
+  // pipe end the worker writes its packets to
+  int outFd;
+
+  // collection index of the test being run, or -1 if idle
+  int32_t test;
+
+  // log id the packets of the running test are written out with
+  int32_t logId;
+
+  // received input that does not yet form a complete line
+  std::string input;
+
+  // packets received for the running test
+  std::vector<std::pair<printer::epacket, std::string>> packets;
+
+  // result reported for the running test
+  logger::result result;
+
+  // timeout of the running test in seconds, <= 0 if it has none
+  int timeout;
+
+  // time at which the running test will have exceeded its timeout
+  std::chrono::steady_clock::time_point deadline;
+
+  worker()
+      : pid(-1),
+        cmdFd(-1),
+        outFd(-1),
+        test(-1),
+        logId(-1),
+        input(),
+        packets(),
+        result(logger::epending),
+        timeout(-1),
+        deadline() {}
+};
+
+/** return true if the data of a packet type is an integer
+ */
+static bool is_int_packet(printer::epacket packet) {
+  switch (packet) {
+    case (printer::line):
+    case (printer::progress):
+    case (printer::result):
+    case (printer::test_start):
+    case (printer::test_end):
+    case (printer::list_test_count):
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** parse a line of the form {"id":0,"type":0,"data":"..."}
+ *  as written by the json formatter.
+ */
+static bool parse_packet(const std::string &line, printer::epacket &packet,
+                         std::string &data) {
+  int id = 0;
+  int type = 0;
+  if (sscanf(line.c_str(), "{\"id\":%d,\"type\":%d,", &id, &type) != 2) {
+    return false;
+  }
+
+  // the data is not escaped so take everything up to the closing quote
+  const std::string dataKey = "\"data\":\"";
+  const std::string::size_type begin = line.find(dataKey);
+  const std::string::size_type end = line.rfind("\"}");
+  if (begin == std::string::npos || end == std::string::npos ||
+      end < begin + dataKey.size()) {
+    return false;
+  }
+
+  packet = static_cast<printer::epacket>(type);
+  data = line.substr(begin + dataKey.size(), end - begin - dataKey.size());
+  return true;
+}
+
+/** constructor
+ */
+supervisor::supervisor(int32_t workerCount)
+    : m_workerCount(workerCount > 1 ? workerCount : 1),
+      m_tests(nullptr),
+      m_nextTest(0),
+      m_fatal(false),
+      m_workers() {}
+
+/** destructor
+ */
+supervisor::~supervisor() {}
+
+#if defined(SYCL_CTS_HAS_FORK)
+
+/** return true if worker processes can be forked on this platform
+ */
+bool supervisor::is_supported() { return true; }
+
+/** call a function in a short lived child process and return its result
+ */
+std::string supervisor::run_isolated(std::string (*fn)()) {
+  int outPipe[2];
+  if (pipe(outPipe) != 0) return fn();
+
+  get<printer>().finish();
+  fflush(nullptr);
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    close(outPipe[0]);
+    close(outPipe[1]);
+    return fn();
+  }
+
+  if (pid == 0) {
+    close(outPipe[0]);
+    const std::string result = fn();
+    const char *data = result.data();
+    size_t remaining = result.size();
+    while (remaining > 0) {
+      const ssize_t written = write(outPipe[1], data, remaining);
+      if (written <= 0) break;
+      data += written;
+      remaining -= size_t(written);
+    }
+    _exit(0);
+  }
+
+  close(outPipe[1]);
+  std::string result;
+  char buffer[4096];
+  ssize_t bytes;
+  while ((bytes = read(outPipe[0], buffer, sizeof(buffer))) != 0) {
+    if (bytes < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    result.append(buffer, size_t(bytes));
+  }
+  close(outPipe[0]);
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return result;
+}
+
+/** the main loop of a worker process
+ *  runs each test index read from the command pipe until told to exit.
+ */
+static void worker_main(int cmdFd, int outFd) {
+  // the supervisor decodes the packets from their JSON form
+  get<printer>().set_format(printer::ejson);
+  get<printer>().set_fd_channel(outFd);
+
+  for (;;) {
+    int32_t index = -1;
+    if (read(cmdFd, &index, sizeof(index)) != sizeof(index) || index < 0) {
+      break;
+    }
+    get<executor>().run_test(get<collection>().get_test(index));
+  }
+
+  // skip atexit handlers and static destructors, these belong to the
+  // supervisor process
+  _exit(0);
+}
+
+/** fork a new worker process into the given slot
+ */
+bool supervisor::spawn(worker &w) {
+  int cmdPipe[2];
+  int outPipe[2];
+  if (pipe(cmdPipe) != 0) return false;
+  if (pipe(outPipe) != 0) {
+    close(cmdPipe[0]);
+    close(cmdPipe[1]);
+    return false;
+  }
+
+  // anything still buffered would otherwise be written by both processes
+  get<printer>().finish();
+  fflush(nullptr);
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    close(cmdPipe[0]);
+    close(cmdPipe[1]);
+    close(outPipe[0]);
+    close(outPipe[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    // the pipes of the other workers must be closed, otherwise their
+    // end of file would never be seen by the supervisor
+    for (auto &other : m_workers) {
+      if (other->cmdFd >= 0) close(other->cmdFd);
+      if (other->outFd >= 0) close(other->outFd);
+    }
+    close(cmdPipe[1]);
+    close(outPipe[0]);
+
+    // die with the supervisor rather than outlive it
+    signal(SIGPIPE, SIG_DFL);
+
+    worker_main(cmdPipe[0], outPipe[1]);
+  }
+
+  close(cmdPipe[0]);
+  close(outPipe[1]);
+
+  w.pid = pid;
+  w.cmdFd = cmdPipe[1];
+  w.outFd = outPipe[0];
+  w.test = -1;
+  w.input.clear();
+  w.packets.clear();
+  return true;
+}
+
+/** hand the next test to a worker or tell it to exit if none remain
+ */
+void supervisor::dispatch(worker &w) {
+  int32_t index = -1;
+  if (!m_fatal && m_nextTest < m_tests->size()) {
+    index = (*m_tests)[m_nextTest++];
+    w.test = index;
+    w.logId = get<printer>().new_log_id();
+    w.packets.clear();
+    w.result = logger::epending;
+
+    w.timeout = get<executor>().get_timeout(get<collection>().get_test(index));
+    w.deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(w.timeout);
+  }
+
+  if (write(w.cmdFd, &index, sizeof(index)) != sizeof(index)) {
+    // the worker has died, this is noticed when its output pipe closes
+    return;
+  }
+}
+
+/** write out the packets of the test a worker was running
+ */
+void supervisor::emit(worker &w) {
+  printer &out = get<printer>();
+  for (const auto &packet : w.packets) {
+    if (is_int_packet(packet.first)) {
+      out.write(w.logId, packet.first, std::atoi(packet.second.c_str()));
+    } else {
+      out.write(w.logId, packet.first, packet.second);
+    }
+  }
+  w.packets.clear();
+}
+
+/** process all complete packets a worker has sent
+ */
+void supervisor::receive(worker &w, std::atomic<int32_t> &numPassed) {
+  std::string::size_type newline;
+  while ((newline = w.input.find('\n')) != std::string::npos) {
+    const std::string line = w.input.substr(0, newline);
+    w.input.erase(0, newline + 1);
+
+    printer::epacket packet;
+    std::string data;
+    if (w.test < 0 || !parse_packet(line, packet, data)) {
+      continue;
+    }
+
+    if (packet == printer::result) {
+      w.result = static_cast<logger::result>(std::atoi(data.c_str()));
+    }
+    if (packet == printer::timing_wall) {
+      get<collection>().get_test(w.test).m_duration = std::atof(data.c_str());
+    }
+    w.packets.push_back(std::make_pair(packet, data));
+
+    if (packet == printer::test_end) {
+      // keep the packets of one test together in the output
+      emit(w);
+      get<collection>().get_test(w.test).m_result = w.result;
+
+      if ((w.result == logger::epass) || (w.result == logger::eskip)) {
+        ++numPassed;
+      }
+
+      // if we received a fatal error then no further tests are started
+      if (w.result == logger::efatal) {
+        m_fatal = true;
+      }
+
+      w.test = -1;
+      dispatch(w);
+    }
+  }
+}
+
+/** wait for a worker process to exit and release its slot
+ */
+int supervisor::retire(worker &w) {
+  close(w.cmdFd);
+  close(w.outFd);
+  w.cmdFd = -1;
+  w.outFd = -1;
+
+  int status = 0;
+  waitpid(w.pid, &status, 0);
+  w.pid = -1;
+  return status;
+}
+
+/** report the test a worker was running when it was lost
+ */
+void supervisor::report_lost(worker &w, const std::string &reason,
+                             logger::result result) {
+  // the worker may have been lost before it could write the test preamble
+  bool hasName = false;
+  for (const auto &packet : w.packets) {
+    hasName |= (packet.first == printer::name);
+  }
+  if (!hasName) {
+    // construct the test here just to find out where it is defined
+    const collection::test_info &info = get<collection>().get_test(w.test);
+    std::unique_ptr<test_base> test(info.m_factory());
+    test_base::info testInfo;
+    test->get_info(testInfo);
+    w.packets.insert(w.packets.begin(),
+                     std::make_pair(printer::name, testInfo.m_name));
+    w.packets.insert(w.packets.begin() + 1,
+                     std::make_pair(printer::file, testInfo.m_file));
+  }
+
+  if (result == logger::efail) {
+    w.packets.push_back(std::make_pair(printer::line, std::string("0")));
+  }
+  w.packets.push_back(std::make_pair(printer::note, reason));
+  w.packets.push_back(
+      std::make_pair(printer::result, std::to_string(int(result))));
+  w.packets.push_back(std::make_pair(printer::test_end, std::string("0")));
+  emit(w);
+  collection::test_info &info = get<collection>().get_test(w.test);
+  info.m_result = result;
+  if (result == logger::etimeout) {
+    // the test ran for at least this long
+    info.m_duration = double(w.timeout);
+  }
+  w.test = -1;
+}
+
+/** replace a lost worker if there are still tests to run
+ */
+void supervisor::replace(worker &w) {
+  if (!m_fatal && m_nextTest < m_tests->size() && spawn(w)) {
+    dispatch(w);
+  }
+}
+
+/** execute the given tests in worker processes
+ */
+bool supervisor::run(const std::vector<int32_t> &tests,
+                     std::atomic<int32_t> &numPassed) {
+  m_tests = &tests;
+  m_nextTest = 0;
+  m_fatal = false;
+
+  // a worker dying must not take the supervisor with it
+  signal(SIGPIPE, SIG_IGN);
+
+  // start the workers, each with a test to run
+  const size_t nWorkers = std::min(size_t(m_workerCount), tests.size());
+  m_workers.clear();
+  for (size_t i = 0; i < nWorkers; i++) {
+    m_workers.push_back(std::unique_ptr<worker>(new worker()));
+    if (!spawn(*m_workers.back())) {
+      get<printer>().print("unable to start a test worker process\n");
+      m_workers.pop_back();
+      break;
+    }
+    dispatch(*m_workers.back());
+  }
+
+  for (;;) {
+    // wait for output from any of the running workers
+    std::vector<pollfd> fds;
+    std::vector<worker *> polled;
+    for (auto &w : m_workers) {
+      if (w->pid < 0) continue;
+      pollfd fd = {w->outFd, POLLIN, 0};
+      fds.push_back(fd);
+      polled.push_back(w.get());
+    }
+    if (fds.empty()) break;
+
+    // wake up in time to enforce the earliest timeout
+    const auto now = std::chrono::steady_clock::now();
+    int waitMs = -1;
+    for (auto w : polled) {
+      if (w->test < 0 || w->timeout <= 0) continue;
+      const auto remaining =
+          std::chrono::duration_cast<std::chrono::milliseconds>(w->deadline -
+                                                                now);
+      const int ms = std::max(0, int(remaining.count()) + 1);
+      waitMs = (waitMs < 0) ? ms : std::min(waitMs, ms);
+    }
+
+    if (poll(fds.data(), fds.size(), waitMs) < 0) continue;
+
+    for (size_t i = 0; i < fds.size(); i++) {
+      if (fds[i].revents == 0) continue;
+      worker &w = *polled[i];
+
+      char buffer[4096];
+      const ssize_t bytes = read(w.outFd, buffer, sizeof(buffer));
+      if (bytes > 0) {
+        w.input.append(buffer, size_t(bytes));
+        receive(w, numPassed);
+        continue;
+      }
+
+      // the output pipe closed, so the worker has exited
+      const int status = retire(w);
+      if (w.test >= 0) {
+        std::string reason = "Test process terminated unexpectedly";
+        if (WIFSIGNALED(status)) {
+          reason = "Test process terminated by signal " +
+                   std::to_string(WTERMSIG(status)) + " (" +
+                   strsignal(WTERMSIG(status)) + ")";
+        } else if (WIFEXITED(status)) {
+          reason = "Test process exited with status " +
+                   std::to_string(WEXITSTATUS(status));
+        }
+        report_lost(w, reason, logger::efail);
+        replace(w);
+      }
+    }
+
+    // kill any worker whose test has exceeded its timeout
+    for (auto w : polled) {
+      if (w->pid < 0 || w->test < 0 || w->timeout <= 0 ||
+          std::chrono::steady_clock::now() < w->deadline) {
+        continue;
+      }
+      kill(w->pid, SIGKILL);
+      retire(*w);
+      report_lost(*w, "Test exceeded its timeout of " +
+                          std::to_string(w->timeout) + " seconds",
+                  logger::etimeout);
+      replace(*w);
+    }
+  }
+
+  m_workers.clear();
+  m_tests = nullptr;
+  return !m_fatal;
+}
+
+#else
+
+/** return true if worker processes can be forked on this platform
+ */
+bool supervisor::is_supported() { return false; }
+
+/** call a function, there is no child process to isolate it in
+ */
+std::string supervisor::run_isolated(std::string (*fn)()) { return fn(); }
+
+/** execute the given tests in worker processes
+ */
+bool supervisor::run(const std::vector<int32_t> &, std::atomic<int32_t> &) {
+  assert(!"Worker processes are not supported on this platform");
+  return false;
+}
+
+#endif  // SYCL_CTS_HAS_FORK
+
+}  // namespace util
+}  // namespace sycl_cts
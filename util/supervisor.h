@@ -0,0 +1,107 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_SUPERVISOR_H
+#define __SYCLCTS_UTIL_SUPERVISOR_H
+
+#include "stl.h"
+#include "logger.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** runs tests in forked worker processes
+ *
+ *  each worker is handed one test at a time over a pipe and streams the
+ *  JSON packets of that test back over a second pipe. should a worker crash
+ *  the test it was running is reported as failed and a new worker is forked
+ *  for the remaining tests. a worker running a test for longer than its
+ *  timeout is killed and replaced in the same way.
+ */
+class supervisor {
+ public:
+  /** return true if worker processes can be forked on this platform
+   */
+  static bool is_supported();
+
+  /** call a function in a short lived child process and return its result,
+   *  so that the SYCL runtime can be queried without initializing it in
+   *  the process workers are later forked from. where processes can't be
+   *  forked the function is called directly.
+   */
+  static std::string run_isolated(std::string (*fn)());
+
+  /** constructor
+   *  @param workerCount, number of worker processes to run at once
+   */
+  explicit supervisor(int32_t workerCount);
+
+  /** destructor
+   */
+  ~supervisor();
+
+  /** execute the given tests in worker processes
+   *  @param tests, indices into the collection of the tests to execute
+   *  @param numPassed, incremented for each passing test
+   *  @return, false if a test reported a fatal error
+   */
+  bool run(const std::vector<int32_t> &tests, std::atomic<int32_t> &numPassed);
+
+ protected:
+  struct worker;
+
+  /** fork a new worker process into the given slot
+   */
+  bool spawn(worker &w);
+
+  /** hand the next test to a worker or tell it to exit if none remain
+   */
+  void dispatch(worker &w);
+
+  /** process all complete packets a worker has sent
+   */
+  void receive(worker &w, std::atomic<int32_t> &numPassed);
+
+  /** wait for a worker process to exit and release its slot
+   *  @return, the exit status of the process
+   */
+  int retire(worker &w);
+
+  /** report the test a worker was running when it was lost
+   *  @param reason, note explaining why the worker was lost
+   *  @param result, result to report for the test
+   */
+  void report_lost(worker &w, const std::string &reason,
+                   logger::result result);
+
+  /** replace a lost worker if there are still tests to run
+   */
+  void replace(worker &w);
+
+  /** write out the packets of the test a worker was running
+   */
+  void emit(worker &w);
+
+  // number of worker processes to run at once
+  int32_t m_workerCount;
+
+  // the tests being executed and the next one to dispatch
+  const std::vector<int32_t> *m_tests;
+  size_t m_nextTest;
+
+  // set once a test reports a fatal error
+  bool m_fatal;
+
+  // the worker process slots
+  std::vector<std::unique_ptr<worker>> m_workers;
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_SUPERVISOR_H
@@ -17,6 +17,15 @@ namespace util {
  */
 class test_base {
  public:
+  /** flags describing how a test may be scheduled
+   */
+  enum eflags {
+    /* the test may run concurrently with other tests */
+    enone = 0,
+    /* the test must run alone, after all concurrent tests have finished */
+    eserial = 1 << 0,
+  };
+
   /** encapsulate information about a test
    */
   struct info {
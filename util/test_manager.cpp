@@ -7,6 +7,11 @@
 *******************************************************************************/
 
 #include <stdlib.h>
+#include <sstream>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
 
 #include "test_manager.h"
 #include "cmdarg.h"
@@ -14,6 +19,10 @@
 #include "printer.h"
 #include "selector.h"
 #include "executor.h"
+#include "supervisor.h"
+#include "results_cache.h"
+#include "history.h"
+#include "trace.h"
 #include "../tests/common/cts_selector.h"
 
 #if defined(_MSC_VER)
@@ -26,7 +35,9 @@ namespace util {
 /**
  */
 test_manager::test_manager() : m_willExecute(false), m_wimpyMode(false),
-  m_infoDump(false), m_infoDumpFile{""} {}
+  m_exhaustiveMode(false), m_infoDump(false), m_infoDumpFile{""},
+  m_binaryPath(), m_resultsCachePath(), m_onlyChanged(false),
+  m_historyPath() {}
 
 /**
  */
@@ -78,17 +89,39 @@ bool test_manager::parse(const int argc, const char **args) {
     printer.set_format(sycl_cts::util::printer::ejson);
   }
 
+  // set compact binary output formatting
+  if (cmdarg.find_key("--binary")) {
+    printer.set_format(sycl_cts::util::printer::ebinary);
+  }
+
   // redirect all output to a file
   std::string filePath;
   if (cmdarg.get_value("--file", filePath) ||
       cmdarg.get_value("-f", filePath)) {
-    if (!printer.set_file_channel(filePath.c_str())) {
+    // optionally write the file from a background thread
+    const bool async = cmdarg.find_key("--async-log");
+    if (async ? !printer.set_async_file_channel(filePath.c_str())
+              : !printer.set_file_channel(filePath.c_str())) {
       std::cout << "unable to create output file!" << std::endl;
       return false;
     } else
       std::cout << "writing output to: \'" << filePath << "\'" << std::endl;
   }
 
+  // anything else writing to stdout would corrupt the binary records
+  if (cmdarg.find_key("--binary") && filePath.empty()) {
+    std::cout << "--binary requires --file" << std::endl;
+    return false;
+  }
+
+  // record a timeline of the run for chrome://tracing or Perfetto
+  std::string tracePath;
+  if (cmdarg.get_value("--trace", tracePath) &&
+      !get<util::trace>().open(tracePath)) {
+    std::cout << "unable to create trace file!" << std::endl;
+    return false;
+  }
+
   // list all of the tests in this binary
   if (cmdarg.find_key("--list") || cmdarg.find_key("-l")) {
     collection.list();
@@ -124,10 +157,107 @@ bool test_manager::parse(const int argc, const char **args) {
     selector.set_default_device(deviceName);
   }
 
+  // share one device and context between tests, and a queue per thread
+  if (cmdarg.find_key("--shared-objects")) {
+    selector.set_shared_objects(true);
+  }
+
+  // profile the kernels executed on the CTS queues
+  if (cmdarg.find_key("--profile-kernels")) {
+    selector.set_profiling(true);
+  }
+
   // filter by the given test name
   std::string testName;
   if (cmdarg.get_value("--test", testName)) {
-    collection.filter_tests_name(testName);
+    if (!collection.filter_tests_name(testName)) {
+      return false;
+    }
+  }
+
+  // schedule tests using the durations and failures of earlier runs
+  const bool failedFirst = cmdarg.find_key("--failed-first");
+  if (cmdarg.get_value("--history", m_historyPath)) {
+    if (!history::load(m_historyPath)) {
+      std::cout << "unable to read the test history" << std::endl;
+      return false;
+    }
+    get<util::executor>().set_schedule(true, failedFirst);
+  } else if (failedFirst) {
+    std::cout << "--failed-first requires --history" << std::endl;
+    return false;
+  }
+
+  // run only one shard of the selected tests
+  std::string shardIndex;
+  std::string shardCount;
+  const bool hasIndex = cmdarg.get_value("--shard-index", shardIndex);
+  const bool hasCount = cmdarg.get_value("--shard-count", shardCount);
+  if (hasIndex || hasCount) {
+    const int32_t index = std::atoi(shardIndex.c_str());
+    const int32_t count = std::atoi(shardCount.c_str());
+    if (!hasIndex || !hasCount || count <= 0 || index < 0 || index >= count) {
+      std::cout << "--shard-index and --shard-count expect an index from 0 "
+                   "to count - 1"
+                << std::endl;
+      return false;
+    }
+    collection.filter_shard(index, count, !m_historyPath.empty());
+  }
+
+  // list the tests which would run rather than running them
+  if (cmdarg.find_key("--list-selected")) {
+    collection.list(true);
+    return true;
+  }
+
+  // run independent tests concurrently on a pool of worker threads
+  std::string jobs;
+  if (cmdarg.get_value("--jobs", jobs)) {
+    const int32_t jobCount = std::atoi(jobs.c_str());
+    if (jobCount <= 0) {
+      std::cout << "--jobs expects a positive number of jobs" << std::endl;
+      return false;
+    }
+    get<util::executor>().set_job_count(jobCount);
+  }
+
+  // run tests in forked worker processes so a crashing test can't take
+  // down the rest of the run
+  std::string workers;
+  if (cmdarg.get_value("--workers", workers)) {
+    const int32_t workerCount = std::atoi(workers.c_str());
+    if (workerCount <= 0) {
+      std::cout << "--workers expects a positive number of processes"
+                << std::endl;
+      return false;
+    }
+    if (!supervisor::is_supported()) {
+      std::cout << "--workers is not supported on this platform" << std::endl;
+      return false;
+    }
+    get<util::executor>().set_worker_count(workerCount);
+  }
+
+  // timeout for tests which do not specify their own
+  std::string timeout;
+  if (cmdarg.get_value("--timeout", timeout) ||
+      cmdarg.get_value("-t", timeout)) {
+    get<util::executor>().set_default_timeout(std::atoi(timeout.c_str()));
+  }
+
+  // run the selected tests several times to expose flaky tests
+  std::string repeat;
+  const bool untilFail = cmdarg.find_key("--repeat-until-fail");
+  if (cmdarg.get_value("--repeat", repeat)) {
+    const int32_t repeatCount = std::atoi(repeat.c_str());
+    if (repeatCount <= 0) {
+      std::cout << "--repeat expects a positive number of rounds" << std::endl;
+      return false;
+    }
+    get<util::executor>().set_repeat(repeatCount, untilFail);
+  } else if (untilFail) {
+    get<util::executor>().set_repeat(0, true);
   }
 
   // check for wimpy mode being enabled
@@ -135,6 +265,20 @@ bool test_manager::parse(const int argc, const char **args) {
     m_wimpyMode = true;
   }
 
+  // check for exhaustive mode being enabled
+  if (cmdarg.find_key("--exhaustive")) {
+    m_exhaustiveMode = true;
+  }
+
+  // record results so that later runs can skip unchanged tests
+  if (cmdarg.get_value("--results-cache", m_resultsCachePath)) {
+    m_binaryPath = (argc > 0) ? args[0] : "";
+    m_onlyChanged = cmdarg.find_key("--only-changed");
+  } else if (cmdarg.find_key("--only-changed")) {
+    std::cout << "--only-changed requires --results-cache" << std::endl;
+    return false;
+  }
+
   // check for device info dump
   std::string infoFile;
   if (cmdarg.get_value("--info-dump", infoFile) ||
@@ -151,8 +295,94 @@ bool test_manager::parse(const int argc, const char **args) {
 /**
  */
 bool test_manager::run() {
+  if (!m_resultsCachePath.empty() && !load_results_cache()) {
+    std::cout << "unable to read the results cache" << std::endl;
+    return false;
+  }
+
   // execute all tests
-  return get<util::executor>().run_all();
+  bool passed;
+  {
+    trace_scope scope("run all", "harness");
+    passed = get<util::executor>().run_all();
+  }
+
+  if (!m_resultsCachePath.empty() && !save_results_cache()) {
+    std::cout << "unable to write the results cache" << std::endl;
+  }
+  if (!m_historyPath.empty() && !history::save(m_historyPath)) {
+    std::cout << "unable to write the test history" << std::endl;
+  }
+  return passed;
+}
+
+namespace {
+// results of earlier runs, used while --results-cache is given
+results_cache gResultsCache;
+}
+
+/** return the path of the running executable
+ */
+static std::string get_binary_path(const std::string &fallback) {
+#if defined(__linux__)
+  char path[4096];
+  const ssize_t size = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (size > 0) return std::string(path, size_t(size));
+#endif
+  return fallback;
+}
+
+/** decide which tests may replay their cached result
+ */
+bool test_manager::load_results_cache() {
+  if (!gResultsCache.load(m_resultsCachePath)) {
+    return false;
+  }
+
+  // skips and passes may depend on the options tests are run with
+  const util::selector &selector = get<util::selector>();
+  const std::string options =
+      "wimpy=" + std::to_string(m_wimpyMode) +
+      " exhaustive=" + std::to_string(m_exhaustiveMode) +
+      " platform=" + std::to_string(int(selector.get_default_platform())) +
+      " device=" + std::to_string(int(selector.get_default_device())) +
+      " shared-objects=" + std::to_string(selector.shared_objects());
+
+  // querying the device initializes the SYCL runtime, which worker
+  // processes must not inherit
+  trace_scope scope("query device", "harness");
+  gResultsCache.set_environment(
+      get_binary_path(m_binaryPath),
+      supervisor::run_isolated(&test_manager::get_environment_info), options);
+
+  if (!m_onlyChanged) {
+    return true;
+  }
+
+  util::collection &collection = get<util::collection>();
+  for (int32_t i = 0; i < collection.get_test_count(); i++) {
+    collection::test_info &info = collection.get_test(i);
+    logger::result result;
+    if (!info.m_skip && gResultsCache.lookup(info.m_name, result) &&
+        ((result == logger::epass) || (result == logger::eskip))) {
+      info.m_replay = true;
+      info.m_result = result;
+    }
+  }
+  return true;
+}
+
+/** record the results of the tests which ran
+ */
+bool test_manager::save_results_cache() {
+  util::collection &collection = get<util::collection>();
+  for (int32_t i = 0; i < collection.get_test_count(); i++) {
+    const collection::test_info &info = collection.get_test(i);
+    if (!info.m_replay && info.m_result != logger::epending) {
+      gResultsCache.store(info.m_name, info.m_result);
+    }
+  }
+  return gResultsCache.save(m_resultsCachePath);
 }
 
 /**
@@ -164,9 +394,18 @@ Usage:
     --help      -h         Show this help message
     --json      -j         Print test results in JSON format
     --text                 Print test results in text format
-    --csv       -c         CSV file for specifying tests to run
+    --binary               Print test results as compact binary records
+                           to the --file, see tools/decode_log.py
+    --csv       -c         CSV file for specifying tests to run, one name
+                           prefix or glob per row as for --test, an
+                           optional second column sets a timeout in seconds
+                           and a third the expected result, such as 'fail'.
+                           lines starting with '#' are comments
     --list      -l         List the tests compiled in this executable
     --wimpy     -w         Run with reduced test complexity (faster)
+    --exhaustive           Run the exhaustive tests, which sweep every
+                           input of a function, such as all 2^32 floats
+                           for the 'math_builtin_exhaustive_*' tests
     --platform  -p [name]  Set a platform to target:
                    'host'
                    'amd'
@@ -178,11 +417,54 @@ Usage:
                    'opencl_cpu'
                    'opencl_gpu'
                    'opencl_accelerator'
+    --shared-objects       Share one device and context between all tests
+                           of a process instead of creating new ones, and
+                           one queue between the tests of each thread.
+                           objects created from an explicit selector are
+                           never shared
+    --profile-kernels      Create the CTS queues with profiling enabled and
+                           report the queueing and device time of the
+                           kernels each test executes on them
     --info-dump -i [file]  Dumps information about the device and platform
                            the tests were executed on to the file specified.
-    --test         [name]  Specify a specific test to run by name, eg.
-                           'unary_math_sin'
+    --test         [name]  Specify the tests to run by name, eg.
+                           'unary_math_sin'. takes a comma separated list
+                           of name prefixes or globs such as 'image_*',
+                           those starting with '!' exclude tests
     --file      -f [path]  Redirect test output to a file
+    --results-cache [path] Record the result of each test in a cache file,
+                           keyed by the binary, runtime and device
+    --only-changed         With --results-cache, only run tests which
+                           failed or whose key changed since they were
+                           cached, replaying the other cached results
+    --history      [path]  Record test durations in a history file and
+                           start the longest running tests first, tests
+                           without a history start before all others
+    --failed-first         With --history, start the tests which failed in
+                           the previous run first
+    --shard-count  [num]   Split the selected tests into 'num' shards, by
+                           a hash of their names or, with --history, by
+                           balancing their durations
+    --shard-index  [num]   The shard to run, from 0 to --shard-count - 1
+    --list-selected        List the tests which would run, after filtering
+                           and sharding, instead of running them
+    --async-log            Write the --file output from a background thread
+    --trace        [path]  Write a Chrome trace event file of the run, with
+                           each test and its phases, device selection,
+                           kernel builds, submissions and waits, for
+                           viewing in chrome://tracing or Perfetto
+    --jobs         [num]   Run up to 'num' tests concurrently, tests marked
+                           as serial run alone afterwards
+    --workers      [num]   Run tests in 'num' forked worker processes, a
+                           crashing test fails without ending the run
+    --timeout   -t [secs]  Timeout for tests which don't set their own, a
+                           timed out test ends the run unless it is running
+                           in a worker process, which is then replaced
+    --repeat       [num]   Run the selected tests 'num' times, reporting
+                           the spread of their durations and how often
+                           each passed, a test passes only if every run did
+    --repeat-until-fail    Repeat until a round has a failing test, up to
+                           the --repeat count if given
 
 )";
   std::cout << usage << std::endl;
@@ -196,84 +478,106 @@ bool test_manager::will_execute() const { return m_willExecute; }
  */
 bool test_manager::wimpy_mode_enabled() const { return m_wimpyMode; }
 
+bool test_manager::exhaustive_mode_enabled() const {
+  return m_exhaustiveMode;
+}
+
 void test_manager::dump_device_info() {
   if (m_infoDump) {
-    cts_selector selector;
-
-    auto chosenDevice = cl::sycl::device(selector);
-    auto chosenPlatform = cl::sycl::platform(selector);
-
     std::fstream infoFile(m_infoDumpFile, std::ios::out);
+    infoFile << get_device_info();
+  }
+}
 
-    auto deviceNameStr = chosenDevice.get_info<cl::sycl::info::device::name>();
-    auto deviceVendorStr =
-        chosenDevice.get_info<cl::sycl::info::device::vendor>();
-    auto deviceType =
-        chosenDevice.get_info<cl::sycl::info::device::device_type>();
-    auto deviceVersionStr =
-        chosenDevice.get_info<cl::sycl::info::device::version>();
-    std::string deviceTypeStr;
-    switch (deviceType) {
-      case cl::sycl::info::device_type::host:
-        deviceTypeStr = "device_type::host";
-        break;
-      case cl::sycl::info::device_type::cpu:
-        deviceTypeStr = "device_type::cpu";
-        break;
-      case cl::sycl::info::device_type::gpu:
-        deviceTypeStr = "device_type::gpu";
-        break;
-      case cl::sycl::info::device_type::accelerator:
-        deviceTypeStr = "device_type::accelerator";
-        break;
-      case cl::sycl::info::device_type::custom:
-        deviceTypeStr = "device_type::custom";
-        break;
-      case cl::sycl::info::device_type::automatic:
-        deviceTypeStr = "device_type::automatic";
-        break;
-      case cl::sycl::info::device_type::all:
-        deviceTypeStr = "device_type::all";
-        break;
-    };
-    auto doesDeviceSupportHalf = chosenDevice.has_extension("cl_khr_fp_16")
+/** return the device info followed by the runtime libraries loaded to
+ *  query it, which only include the vendor driver once it has been queried
+ */
+std::string test_manager::get_environment_info() {
+  const std::string deviceInfo = get_device_info();
+  return deviceInfo + "\n" + results_cache::describe_runtime_libraries();
+}
+
+/** return a JSON description of the device and platform tests run on
+ */
+std::string test_manager::get_device_info() {
+  cts_selector selector;
+
+  auto chosenDevice = cl::sycl::device(selector);
+  auto chosenPlatform = cl::sycl::platform(selector);
+
+  auto deviceNameStr = chosenDevice.get_info<cl::sycl::info::device::name>();
+  auto deviceVendorStr =
+      chosenDevice.get_info<cl::sycl::info::device::vendor>();
+  auto deviceType =
+      chosenDevice.get_info<cl::sycl::info::device::device_type>();
+  auto deviceVersionStr =
+      chosenDevice.get_info<cl::sycl::info::device::version>();
+  auto driverVersionStr =
+      chosenDevice.get_info<cl::sycl::info::device::driver_version>();
+  std::string deviceTypeStr;
+  switch (deviceType) {
+    case cl::sycl::info::device_type::host:
+      deviceTypeStr = "device_type::host";
+      break;
+    case cl::sycl::info::device_type::cpu:
+      deviceTypeStr = "device_type::cpu";
+      break;
+    case cl::sycl::info::device_type::gpu:
+      deviceTypeStr = "device_type::gpu";
+      break;
+    case cl::sycl::info::device_type::accelerator:
+      deviceTypeStr = "device_type::accelerator";
+      break;
+    case cl::sycl::info::device_type::custom:
+      deviceTypeStr = "device_type::custom";
+      break;
+    case cl::sycl::info::device_type::automatic:
+      deviceTypeStr = "device_type::automatic";
+      break;
+    case cl::sycl::info::device_type::all:
+      deviceTypeStr = "device_type::all";
+      break;
+  };
+  auto doesDeviceSupportHalf = chosenDevice.has_extension("cl_khr_fp_16")
+                                   ? "Supported"
+                                   : "Not Supported";
+  auto doesDeviceSupportDouble = chosenDevice.has_extension("cl_khr_fp64")
                                      ? "Supported"
                                      : "Not Supported";
-    auto doesDeviceSupportDouble = chosenDevice.has_extension("cl_khr_fp64")
-                                       ? "Supported"
-                                       : "Not Supported";
-    auto doesDeviceSupportBaseAtomics =
-        chosenDevice.has_extension("cl_khr_int64_base_atomics")
-            ? "Supported"
-            : "Not Supported";
-    auto doesDeviceSupportExtendedAtomics =
-        chosenDevice.has_extension("cl_khr_int64_extended_atomics")
-            ? "Supported"
-            : "Not Supported";
-    auto doesDeviceSupport3DImageWrites =
-        chosenDevice.has_extension("cl_khr_3d_image_writes") ? "Supported"
-                                                             : "Not Supported";
-    auto platformNameStr =
-        chosenPlatform.get_info<cl::sycl::info::platform::name>();
-    auto platformVendorStr =
-        chosenPlatform.get_info<cl::sycl::info::platform::vendor>();
-    auto platformVersionStr =
-        chosenPlatform.get_info<cl::sycl::info::platform::version>();
-
-    infoFile << "{\"device-name\": \"" << deviceNameStr
-             << "\", \"device-vendor\": \"" << deviceVendorStr
-             << "\", \"device-type\": \"" << deviceTypeStr
-             << "\", \"device-version\": \"" << deviceVersionStr
-             << "\", \"device-fp16\": \"" << doesDeviceSupportHalf
-             << "\", \"device-fp64\": \"" << doesDeviceSupportDouble
-             << "\", \"device-int64-base\": \"" << doesDeviceSupportBaseAtomics
-             << "\", \"device-int64-extended\": \""
-             << doesDeviceSupportExtendedAtomics
-             << "\", \"device-3d-writes\": \"" << doesDeviceSupport3DImageWrites
-             << "\", \"platform-name\": \"" << platformNameStr
-             << "\", \"platform-vendor\": \"" << platformVendorStr
-             << "\", \"platform-version\": \"" << platformVersionStr << "\"}";
-  }
+  auto doesDeviceSupportBaseAtomics =
+      chosenDevice.has_extension("cl_khr_int64_base_atomics")
+          ? "Supported"
+          : "Not Supported";
+  auto doesDeviceSupportExtendedAtomics =
+      chosenDevice.has_extension("cl_khr_int64_extended_atomics")
+          ? "Supported"
+          : "Not Supported";
+  auto doesDeviceSupport3DImageWrites =
+      chosenDevice.has_extension("cl_khr_3d_image_writes") ? "Supported"
+                                                           : "Not Supported";
+  auto platformNameStr =
+      chosenPlatform.get_info<cl::sycl::info::platform::name>();
+  auto platformVendorStr =
+      chosenPlatform.get_info<cl::sycl::info::platform::vendor>();
+  auto platformVersionStr =
+      chosenPlatform.get_info<cl::sycl::info::platform::version>();
+
+  std::stringstream info;
+  info << "{\"device-name\": \"" << deviceNameStr
+       << "\", \"device-vendor\": \"" << deviceVendorStr
+       << "\", \"device-type\": \"" << deviceTypeStr
+       << "\", \"device-version\": \"" << deviceVersionStr
+       << "\", \"driver-version\": \"" << driverVersionStr
+       << "\", \"device-fp16\": \"" << doesDeviceSupportHalf
+       << "\", \"device-fp64\": \"" << doesDeviceSupportDouble
+       << "\", \"device-int64-base\": \"" << doesDeviceSupportBaseAtomics
+       << "\", \"device-int64-extended\": \""
+       << doesDeviceSupportExtendedAtomics
+       << "\", \"device-3d-writes\": \"" << doesDeviceSupport3DImageWrites
+       << "\", \"platform-name\": \"" << platformNameStr
+       << "\", \"platform-vendor\": \"" << platformVendorStr
+       << "\", \"platform-version\": \"" << platformVersionStr << "\"}";
+  return info.str();
 }
 
 }  // namespace util
@@ -43,8 +43,22 @@ class test_manager : public singleton<test_manager> {
    */
   bool wimpy_mode_enabled() const;
 
+  /** return true if tests should sweep every input they can, such as all
+   *  single precision floats
+   */
+  bool exhaustive_mode_enabled() const;
+
   void dump_device_info();
 
+  /** return a JSON description of the device and platform tests run on
+   */
+  static std::string get_device_info();
+
+  /** return the device info and the runtime libraries which results are
+   *  cached against
+   */
+  static std::string get_environment_info();
+
   /** program lifetime hooks
    */
   void on_start();
@@ -53,8 +67,29 @@ class test_manager : public singleton<test_manager> {
  protected:
   bool m_willExecute;
   bool m_wimpyMode;
+  bool m_exhaustiveMode;
   bool m_infoDump;
   std::string m_infoDumpFile;
+
+  /** decide which tests may replay their cached result
+   */
+  bool load_results_cache();
+
+  /** record the results of the tests which ran
+   */
+  bool save_results_cache();
+
+  // path of the test executable
+  std::string m_binaryPath;
+
+  // file recording the results of earlier runs, empty if not used
+  std::string m_resultsCachePath;
+
+  // only run tests which changed or failed since they were cached
+  bool m_onlyChanged;
+
+  // file recording test durations and failures, empty if not used
+  std::string m_historyPath;
 };
 
 }  // namespace util
@@ -0,0 +1,85 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include "timing.h"
+
+namespace sycl_cts {
+namespace util {
+
+#if defined(_MSC_VER)
+
+/** convert a FILETIME duration in 100ns units to seconds
+ */
+static double to_seconds(const FILETIME &time) {
+  ULARGE_INTEGER value;
+  value.LowPart = time.dwLowDateTime;
+  value.HighPart = time.dwHighDateTime;
+  return double(value.QuadPart) * 1e-7;
+}
+
+#else
+
+/** convert a timeval to seconds
+ */
+static double to_seconds(const timeval &time) {
+  return double(time.tv_sec) + double(time.tv_usec) * 1e-6;
+}
+
+#endif
+
+/** sample the wall clock and the cpu time of the calling thread
+ */
+time_sample sample_time() {
+  time_sample sample;
+
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  sample.m_wall = std::chrono::duration<double>(now).count();
+
+#if defined(_MSC_VER)
+  FILETIME creation, exit, kernel, user;
+  sample.m_perThread = true;
+  if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    sample.m_user = to_seconds(user);
+    sample.m_system = to_seconds(kernel);
+  } else {
+    sample.m_user = 0.0;
+    sample.m_system = 0.0;
+  }
+#else
+  rusage usage;
+#if defined(RUSAGE_THREAD)
+  // other tests may be running concurrently on other threads
+  sample.m_perThread = true;
+  const int who = RUSAGE_THREAD;
+#else
+  sample.m_perThread = false;
+  const int who = RUSAGE_SELF;
+#endif
+  if (getrusage(who, &usage) == 0) {
+    sample.m_user = to_seconds(usage.ru_utime);
+    sample.m_system = to_seconds(usage.ru_stime);
+  } else {
+    sample.m_user = 0.0;
+    sample.m_system = 0.0;
+  }
+#endif
+
+  return sample;
+}
+
+}  // namespace util
+}  // namespace sycl_cts
@@ -0,0 +1,41 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_TIMING_H
+#define __SYCLCTS_UTIL_TIMING_H
+
+namespace sycl_cts {
+namespace util {
+
+/** the wall clock and cpu time at a point during execution
+ *  all times are given in seconds
+ */
+struct time_sample {
+  // monotonic wall clock time
+  double m_wall;
+
+  // cpu time spent in user mode
+  double m_user;
+
+  // cpu time spent in the kernel
+  double m_system;
+
+  // true if the cpu times cover only the calling thread rather than the
+  // whole process
+  bool m_perThread;
+};
+
+/** sample the wall clock and the cpu time of the calling thread, where the
+ *  platform can not report per thread cpu time that of the process is used
+ */
+time_sample sample_time();
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_TIMING_H
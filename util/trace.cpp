@@ -0,0 +1,114 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <chrono>
+
+#include "trace.h"
+
+namespace sycl_cts {
+namespace util {
+
+namespace {
+
+/** return a small number identifying the calling thread
+ */
+int thread_index() {
+  static std::atomic<int> nextIndex(0);
+  static thread_local int index = nextIndex++;
+  return index;
+}
+
+/** append a string to an event, escaped as a JSON string
+ */
+void append_escaped(std::string &out, const std::string &str) {
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out += ' ';
+    } else {
+      out += c;
+    }
+  }
+}
+
+}  // namespace
+
+/** constructor
+ */
+trace::trace() : m_file(nullptr), m_mutex() {}
+
+/** destructor
+ */
+trace::~trace() {
+  if (m_file != nullptr) {
+    fclose(m_file);
+  }
+}
+
+/** start writing events to a file, replacing its contents
+ */
+bool trace::open(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (file == nullptr) return false;
+  fputs("[\n", file);
+  fclose(file);
+
+  // events are appended so forked workers can share the file
+  m_file = fopen(path.c_str(), "a");
+  return m_file != nullptr;
+}
+
+/** return the current time in seconds
+ */
+double trace::now() {
+  const auto time = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double>(time).count();
+}
+
+/** record an event with a known start and end
+ */
+void trace::complete(const char *name, const char *category, double start,
+                     double end, const std::string &detail) {
+  if (m_file == nullptr) return;
+
+  char times[96];
+  snprintf(times, sizeof(times),
+           "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+           start * 1e6, (end - start) * 1e6, int(getpid()), thread_index());
+
+  std::string event = "{\"name\":\"";
+  append_escaped(event, name);
+  event += "\",\"cat\":\"";
+  append_escaped(event, category);
+  event += times;
+  if (!detail.empty()) {
+    event += ",\"args\":{\"detail\":\"";
+    append_escaped(event, detail);
+    event += "\"}";
+  }
+  event += "},\n";
+
+  // each event is flushed as one write, so appends from worker processes
+  // do not interleave
+  std::lock_guard<std::mutex> lock(m_mutex);
+  fwrite(event.data(), 1, event.size(), m_file);
+  fflush(m_file);
+}
+
+}  // namespace util
+}  // namespace sycl_cts
@@ -0,0 +1,99 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_TRACE_H
+#define __SYCLCTS_UTIL_TRACE_H
+
+#include <cstdio>
+
+#include "stl.h"
+#include "singleton.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** writer of a Chrome trace event file, as viewed in chrome://tracing or
+ *  Perfetto
+ *
+ *  events are appended as single lines of the JSON array format, which
+ *  allows the closing bracket to be left out, so worker processes can
+ *  append to the same file and a crashed run still leaves a valid trace.
+ */
+class trace : public singleton<trace> {
+ public:
+  /** constructor
+   */
+  trace();
+
+  /** destructor
+   */
+  ~trace();
+
+  /** start writing events to a file, replacing its contents
+   *  @return, false if the file could not be created
+   */
+  bool open(const std::string &path);
+
+  /** return true if events are being recorded
+   */
+  bool enabled() const { return m_file != nullptr; }
+
+  /** return the current time in seconds on the clock used by sample_time
+   */
+  static double now();
+
+  /** record an event with a known start and end
+   *  @param name, shown on the timeline
+   *  @param category, used to filter events in the viewer
+   *  @param start, end, times in seconds as returned by now()
+   *  @param detail, optional text shown with the event
+   */
+  void complete(const char *name, const char *category, double start,
+                double end, const std::string &detail = "");
+
+ protected:
+  // file events are appended to, nullptr while disabled
+  FILE *m_file;
+
+  // serializes writes from concurrently executing tests
+  std::mutex m_mutex;
+};
+
+/** record the lifetime of a scope as a trace event
+ */
+class trace_scope {
+ public:
+  /** constructor
+   *  @param name, category, must outlive the scope
+   */
+  trace_scope(const char *name, const char *category)
+      : m_name(name),
+        m_category(category),
+        m_start(get<trace>().enabled() ? trace::now() : 0.0) {}
+
+  /** destructor
+   */
+  ~trace_scope() {
+    if (get<trace>().enabled()) {
+      get<trace>().complete(m_name, m_category, m_start, trace::now());
+    }
+  }
+
+ protected:
+  const char *m_name;
+  const char *m_category;
+  double m_start;
+
+  // disable copy constructors
+  trace_scope(const trace_scope &);
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_TRACE_H
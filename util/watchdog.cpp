@@ -0,0 +1,133 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#include <cstdlib>
+
+#include "watchdog.h"
+#include "logger.h"
+#include "printer.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** constructor
+ */
+watchdog::watchdog(const std::atomic<int32_t> &numPassed, int32_t numTests)
+    : m_numPassed(numPassed),
+      m_numTests(numTests),
+      m_mutex(),
+      m_wake(),
+      m_entries(),
+      m_nextHandle(0),
+      m_stop(false),
+      m_thread() {}
+
+/** destructor
+ */
+watchdog::~watchdog() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+/** start watching a test
+ */
+int32_t watchdog::start(const test_base::info &testInfo, int timeout) {
+  if (timeout <= 0) {
+    return -1;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // the thread is only started once there is something to watch
+  if (!m_thread.joinable()) {
+    m_thread = std::thread(&watchdog::watch, this);
+  }
+
+  entry e;
+  e.handle = m_nextHandle++;
+  e.timeout = timeout;
+  e.deadline = clock::now() + std::chrono::seconds(timeout);
+  e.testInfo = testInfo;
+  m_entries.push_back(e);
+
+  m_wake.notify_all();
+  return e.handle;
+}
+
+/** stop watching a test that has finished
+ */
+void watchdog::stop(int32_t handle) {
+  if (handle < 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->handle == handle) {
+      m_entries.erase(it);
+      break;
+    }
+  }
+  m_wake.notify_all();
+}
+
+/** the watchdog thread
+ */
+void watchdog::watch() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop) {
+    if (m_entries.empty()) {
+      m_wake.wait(lock);
+      continue;
+    }
+
+    // find the test which will time out first
+    auto first = m_entries.begin();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+      if (it->deadline < first->deadline) first = it;
+    }
+
+    if (clock::now() >= first->deadline) {
+      expire(*first);
+    }
+
+    // the entry may be removed while waiting
+    const clock::time_point deadline = first->deadline;
+    m_wake.wait_until(lock, deadline);
+  }
+}
+
+/** report a test that exceeded its timeout and end the run
+ */
+void watchdog::expire(const entry &e) {
+  // the tests still running won't get to write out what they captured
+  get<printer>().flush_captures();
+
+  logger log;
+  log.preamble(e.testInfo);
+  log.test_start();
+  log.timeout(e.timeout);
+  log.test_end();
+
+  log.note("Ending test run, a test which has timed out can't be stopped");
+  log.note("Passed %d/%d tests before the run ended", m_numPassed.load(),
+           m_numTests);
+
+  // nothing else will get the chance to flush the output
+  get<printer>().finish();
+  std::_Exit(EXIT_FAILURE);
+}
+
+}  // namespace util
+}  // namespace sycl_cts
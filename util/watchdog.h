@@ -0,0 +1,89 @@
+/*******************************************************************************
+//
+//  SYCL 1.2.1 Conformance Test Suite
+//
+//  Copyright:	(c) 2017 by Codeplay Software LTD. All Rights Reserved.
+//
+*******************************************************************************/
+
+#ifndef __SYCLCTS_UTIL_WATCHDOG_H
+#define __SYCLCTS_UTIL_WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include "stl.h"
+#include "test_base.h"
+
+namespace sycl_cts {
+namespace util {
+
+/** watches the tests running in this process and ends the run if one of
+ *  them exceeds its timeout.
+ *
+ *  a thread stuck inside a SYCL runtime can't be interrupted, so a timed out
+ *  test is reported with logger::etimeout and the process exits once the
+ *  output captured by the other running tests and a summary are written.
+ */
+class watchdog {
+ public:
+  /** constructor
+   *  @param numPassed, number of tests which have passed so far
+   *  @param numTests, number of tests in the collection
+   */
+  watchdog(const std::atomic<int32_t> &numPassed, int32_t numTests);
+
+  /** destructor
+   *  stops the watchdog thread
+   */
+  ~watchdog();
+
+  /** start watching a test
+   *  @param testInfo, information about the test that is starting
+   *  @param timeout, seconds the test may run for, <= 0 to not watch it
+   *  @return, handle to pass to stop()
+   */
+  int32_t start(const test_base::info &testInfo, int timeout);
+
+  /** stop watching a test that has finished
+   */
+  void stop(int32_t handle);
+
+ protected:
+  typedef std::chrono::steady_clock clock;
+
+  /** a test being watched
+   */
+  struct entry {
+    int32_t handle;
+    int timeout;
+    clock::time_point deadline;
+    test_base::info testInfo;
+  };
+
+  /** the watchdog thread
+   */
+  void watch();
+
+  /** report a test that exceeded its timeout and end the run
+   */
+  void expire(const entry &e);
+
+  // reported should a test time out
+  const std::atomic<int32_t> &m_numPassed;
+  int32_t m_numTests;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::vector<entry> m_entries;
+  int32_t m_nextHandle;
+  bool m_stop;
+  std::thread m_thread;
+};
+
+}  // namespace util
+}  // namespace sycl_cts
+
+#endif  // __SYCLCTS_UTIL_WATCHDOG_H